@@ -1,5 +1,5 @@
-set render=src\engine\render\render.c src\engine\render\render_init.c src\engine\render\render_util.c
-set io=src\engine\io\io.c
+set render=src\engine\render\render.c src\engine\render\render_init.c src\engine\render\render_util.c src\engine\render\render_state.c src\engine\render\render_batch.c src\engine\render\render_thread.c src\engine\render\render_capture.c src\engine\render\render_stats.c src\engine\render\render_soft.c src\engine\render\render_shader_cache.c src\engine\render\render_texture.c src\engine\render\render_image.c src\engine\render\render_palette.c src\engine\render\render_video.c src\engine\render\render_text.c
+set io=src\engine\io\io.c src\engine\io\io_png.c src\engine\io\io_map.c
 set config=src\engine\config\config.c
 set input=src\engine\input\input.c
 set time=src\engine\time\time.c
@@ -8,7 +8,11 @@ set array_list=src\engine\array_list\array_list.c
 set entity=src\engine\entity\entity.c
 set animation=src\engine\animation\animation.c
 set audio=src\engine\audio\audio.c
-set files=src\glad.c src\main.c src\engine\global.c %render% %io% %config% %input% %time% %physics% %array_list% %entity% %animation% %audio%
-set libs=W:\lib\SDL2main.lib W:\lib\SDL2.lib W:\lib\SDL2_mixer.lib
+set camera=src\engine\camera\camera.c
+set tilemap=src\engine\tilemap\tilemap.c
+set job=src\engine\job\job.c
+set ui=src\engine\ui\ui.c
+set files=src\glad.c src\main.c src\engine\global.c %render% %io% %config% %input% %time% %physics% %array_list% %entity% %animation% %audio% %camera% %tilemap% %job% %ui%
+set libs=W:\lib\SDL2main.lib W:\lib\SDL2.lib W:\lib\freetype.lib W:\lib\SDL2_mixer.lib
 
 CL /Zi /I W:\include %files% /link %libs% /OUT:mygame.exe
\ No newline at end of file
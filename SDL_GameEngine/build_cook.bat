@@ -0,0 +1,6 @@
+set io=src\engine\io\io.c src\engine\io\io_png.c src\engine\io\io_map.c
+set files=src\tools\cook.c %io%
+
+CL /Zi /I W:\include %files% /link /OUT:cook.exe
+
+for %%f in (assets\*.png) do cook.exe %%f
\ No newline at end of file
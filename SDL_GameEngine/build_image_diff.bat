@@ -0,0 +1,4 @@
+set io=src\engine\io\io.c src\engine\io\io_png.c src\engine\io\io_map.c
+set files=src\tools\image_diff.c %io%
+
+CL /Zi /I W:\include %files% /link /OUT:image_diff.exe
\ No newline at end of file
@@ -0,0 +1,9 @@
+set render=src\engine\render\render.c src\engine\render\render_init.c src\engine\render\render_util.c src\engine\render\render_state.c src\engine\render\render_batch.c src\engine\render\render_thread.c src\engine\render\render_capture.c src\engine\render\render_stats.c src\engine\render\render_soft.c src\engine\render\render_shader_cache.c src\engine\render\render_texture.c src\engine\render\render_image.c src\engine\render\render_palette.c src\engine\render\render_video.c src\engine\render\render_text.c
+set io=src\engine\io\io.c src\engine\io\io_png.c src\engine\io\io_map.c
+set array_list=src\engine\array_list\array_list.c
+set camera=src\engine\camera\camera.c
+set job=src\engine\job\job.c
+set files=src\glad.c src\tools\replay.c src\engine\global.c %render% %io% %array_list% %camera% %job%
+set libs=W:\lib\SDL2main.lib W:\lib\SDL2.lib W:\lib\freetype.lib
+
+CL /Zi /I W:\include %files% /link %libs% /OUT:replay.exe
\ No newline at end of file
@@ -1,8 +1,17 @@
 #version 330 core
 
+// Features are switched on by defines inserted after the version line:
+// TEXTURED, TINTED, ALPHA_TEST and PALETTED. Without TEXTURED the vertex
+// colour is the output. With PALETTED, quads with a palette sample an
+// index and look their colour up in that palette's row.
+
 out vec4 o_color;
 
+#if !defined(TEXTURED) || defined(TINTED)
 in vec4 v_color;
+#endif
+
+#ifdef TEXTURED
 in vec2 v_uvs;
 flat in int v_texture_slot;
 
@@ -14,16 +23,43 @@ uniform sampler2D texture_slot_4;
 uniform sampler2D texture_slot_5;
 uniform sampler2D texture_slot_6;
 uniform sampler2D texture_slot_7;
+#endif
+
+#ifdef PALETTED
+flat in int v_palette;
+
+uniform sampler2D palette_texture;
+#endif
 
 void main() {
+#ifdef TEXTURED
 	switch(v_texture_slot) {
-		case 0 : o_color = texture(texture_slot_0, v_uvs) * v_color; break;
-		case 1 : o_color = texture(texture_slot_1, v_uvs) * v_color; break;
-		case 2 : o_color = texture(texture_slot_2, v_uvs) * v_color; break;
-		case 3 : o_color = texture(texture_slot_3, v_uvs) * v_color; break;
-		case 4 : o_color = texture(texture_slot_4, v_uvs) * v_color; break;
-		case 5 : o_color = texture(texture_slot_5, v_uvs) * v_color; break;
-		case 6 : o_color = texture(texture_slot_6, v_uvs) * v_color; break;
-		case 7 : o_color = texture(texture_slot_7, v_uvs) * v_color; break;
+		case 0 : o_color = texture(texture_slot_0, v_uvs); break;
+		case 1 : o_color = texture(texture_slot_1, v_uvs); break;
+		case 2 : o_color = texture(texture_slot_2, v_uvs); break;
+		case 3 : o_color = texture(texture_slot_3, v_uvs); break;
+		case 4 : o_color = texture(texture_slot_4, v_uvs); break;
+		case 5 : o_color = texture(texture_slot_5, v_uvs); break;
+		case 6 : o_color = texture(texture_slot_6, v_uvs); break;
+		case 7 : o_color = texture(texture_slot_7, v_uvs); break;
+	}
+
+#ifdef PALETTED
+	if(v_palette > 0) {
+		o_color = texelFetch(palette_texture, ivec2(int(o_color.r * 255.0 + 0.5), v_palette - 1), 0);
+	}
+#endif
+
+#ifdef TINTED
+	o_color *= v_color;
+#endif
+#else
+	o_color = v_color;
+#endif
+
+#ifdef ALPHA_TEST
+	if(o_color.a < 0.5) {
+		discard;
 	}
+#endif
 }
\ No newline at end of file
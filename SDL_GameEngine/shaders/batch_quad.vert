@@ -3,17 +3,35 @@
 layout (location = 0) in vec2 a_pos;
 layout (location = 1) in vec2 a_uvs;
 layout (location = 2) in vec4 a_color;
-layout (location = 3) in float a_texture_slot;
+layout (location = 3) in uint a_texture_slot;
+layout (location = 4) in uint a_order;
 
+#if !defined(TEXTURED) || defined(TINTED)
 out vec4 v_color;
+#endif
+
+#ifdef TEXTURED
 out vec2 v_uvs;
 flat out int v_texture_slot;
+#endif
+
+#ifdef PALETTED
+flat out int v_palette;
+#endif
 
 uniform mat4 projection;
 
 void main() {
+#if !defined(TEXTURED) || defined(TINTED)
 	v_color = a_color;
+#endif
+#ifdef TEXTURED
 	v_uvs = a_uvs;
-	v_texture_slot = int(a_texture_slot);
+	v_texture_slot = int(a_texture_slot & 7u);
+#endif
+#ifdef PALETTED
+	v_palette = int(a_texture_slot >> 3u);
+#endif
 	gl_Position = projection *vec4(a_pos, 0.0, 1.0);
+	gl_Position.z = 1.0 - float(a_order + 1u) / 32768.0;
 }
\ No newline at end of file
@@ -90,9 +90,17 @@ void animation_update(f32 dt) {
 	}
 }
 
-void animation_render(Animation *animation, vec2 position, vec4 color, ui32 texture_slots[8]) {
+// Returns false when the frame's cell is empty.
+bool animation_sprite(Animation *animation, vec2 position, vec4 color, Sprite_Instance *sprite) {
 	Animation_Definition *adef = array_list_get(animation_definition_storage, animation->animation_definition_id);
 	Animation_Frame *aframe = &adef->frames[animation->current_frame_index];
 
-	render_sprite_sheet_frame(adef->sprite_sheet, aframe->row, aframe->column, position, animation->is_flipped, WHITE, texture_slots);
+	return render_sprite_sheet_instance(sprite, adef->sprite_sheet, aframe->row, aframe->column, position, animation->is_flipped, color);
+}
+
+void animation_render(Animation *animation, vec2 position, vec4 color) {
+	Sprite_Instance sprite;
+	if(animation_sprite(animation, position, WHITE, &sprite)) {
+		render_sprites(&sprite, 1);
+	}
 }
\ No newline at end of file
@@ -11,5 +11,6 @@ typedef struct array_list {
 
 Array_List *array_list_create(usize item_size, usize initial_capacity);
 usize array_list_append(Array_List *list, void *item);
+void *array_list_append_n(Array_List *list, usize count);
 void *array_list_get(Array_List *list, usize index);
 ui8 array_list_remove(Array_List *list, usize index);
\ No newline at end of file
@@ -42,6 +42,28 @@ usize array_list_append(Array_List *list, void *item) {
 	return index;
 }
 
+void *array_list_append_n(Array_List *list, usize count) {
+	if(list->len + count > list->capacity) {
+		usize capacity = list->capacity > 0 ? list->capacity : 1;
+		while(capacity < list->len + count) {
+			capacity *= 2;
+		}
+
+		void *items = realloc(list->items, list->item_size * capacity);
+		if(!items) {
+			ERROR_RETURN(NULL, "Could not allocate memory for Array_List\n");
+		}
+
+		list->items = items;
+		list->capacity = capacity;
+	}
+
+	usize index = list->len;
+	list->len += count;
+
+	return (ui8*)list->items + index * list->item_size;
+}
+
 void *array_list_get(Array_List *list, usize index) {
 	if(index >= list->len) {
 		printf("WARNING: array_list_get: Index %zd our of bounds\n", index);
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdbool.h>
+#include <linmath.h>
+#include "types.h"
+
+typedef struct camera_state {
+	vec2 position;
+	vec2 size;
+	f32 zoom;
+} Camera_State;
+
+void camera_init(f32 width, f32 height);
+void camera_set_position(vec2 position);
+void camera_set_zoom(f32 zoom);
+void camera_view_rect(vec4 rect);
+void camera_view_projection(mat4x4 result);
+bool camera_is_visible(vec2 min, vec2 max);
\ No newline at end of file
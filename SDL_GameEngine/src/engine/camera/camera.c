@@ -0,0 +1,43 @@
+#include "../camera.h"
+#include "../global.h"
+
+void camera_init(f32 width, f32 height) {
+	global.camera = (Camera_State){
+		.position = {width * 0.5, height * 0.5},
+		.size = {width, height},
+		.zoom = 1
+	};
+}
+
+void camera_set_position(vec2 position) {
+	global.camera.position[0] = position[0];
+	global.camera.position[1] = position[1];
+}
+
+void camera_set_zoom(f32 zoom) {
+	global.camera.zoom = zoom > 0 ? zoom : 1;
+}
+
+void camera_view_rect(vec4 rect) {
+	f32 half_width = global.camera.size[0] * 0.5 / global.camera.zoom;
+	f32 half_height = global.camera.size[1] * 0.5 / global.camera.zoom;
+
+	rect[0] = global.camera.position[0] - half_width;
+	rect[1] = global.camera.position[1] - half_height;
+	rect[2] = global.camera.position[0] + half_width;
+	rect[3] = global.camera.position[1] + half_height;
+}
+
+void camera_view_projection(mat4x4 result) {
+	vec4 rect;
+	camera_view_rect(rect);
+
+	mat4x4_ortho(result, rect[0], rect[2], rect[1], rect[3], -2, 2);
+}
+
+bool camera_is_visible(vec2 min, vec2 max) {
+	vec4 rect;
+	camera_view_rect(rect);
+
+	return max[0] >= rect[0] && max[1] >= rect[1] && min[0] <= rect[2] && min[1] <= rect[3];
+}
\ No newline at end of file
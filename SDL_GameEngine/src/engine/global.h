@@ -4,11 +4,13 @@
 #include "config.h"
 #include "input.h"
 #include "time.h"
+#include "camera.h"
 
 typedef struct global {
 	Config_State config;
 	Input_State input;
 	Time_State time;
+	Camera_State camera;
 } Global;
 
 extern Global global;
\ No newline at end of file
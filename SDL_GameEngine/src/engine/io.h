@@ -2,6 +2,7 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include "types.h"
 
 typedef struct file {
 	char *data;
@@ -9,5 +10,16 @@ typedef struct file {
 	bool is_valid;
 } File;
 
+typedef struct mapped_file {
+	const ui8 *data;
+	usize len;
+	bool is_valid;
+} Mapped_File;
+
 File io_file_read(const char *path);
-int io_file_write(void *buffer, size_t size, const char *path);
\ No newline at end of file
+int io_file_write(void *buffer, size_t size, const char *path);
+int io_png_write(const char *path, const ui8 *pixels, ui32 width, ui32 height);
+bool io_file_exists(const char *path);
+bool io_file_stat(const char *path, ui64 *size, i64 *mtime);
+Mapped_File io_file_map(const char *path);
+void io_file_unmap(Mapped_File *file);
\ No newline at end of file
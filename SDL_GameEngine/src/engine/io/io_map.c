@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "../types.h"
+#include "../util.h"
+#include "../io.h"
+
+bool io_file_exists(const char *path) {
+	FILE *fp = fopen(path, "rb");
+	if(!fp) {
+		return false;
+	}
+
+	fclose(fp);
+	return true;
+}
+
+// Size in bytes and last modification time in seconds.
+bool io_file_stat(const char *path, ui64 *size, i64 *mtime) {
+#ifdef _WIN32
+	struct _stat64 info;
+	if(_stat64(path, &info) != 0) {
+		return false;
+	}
+#else
+	struct stat info;
+	if(stat(path, &info) != 0) {
+		return false;
+	}
+#endif
+
+	*size = (ui64)info.st_size;
+	*mtime = (i64)info.st_mtime;
+	return true;
+}
+
+// Maps a file read-only. Pages are loaded on first touch, so nothing is
+// copied until the data is used.
+Mapped_File io_file_map(const char *path) {
+	Mapped_File file = { .is_valid = false };
+
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(handle == INVALID_HANDLE_VALUE) {
+		ERROR_RETURN(file, "Cannot map file: %s\n", path);
+	}
+
+	LARGE_INTEGER size;
+	HANDLE mapping = NULL;
+	if(GetFileSizeEx(handle, &size) && size.QuadPart > 0) {
+		mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	}
+	CloseHandle(handle);
+
+	if(!mapping) {
+		ERROR_RETURN(file, "Cannot map file: %s\n", path);
+	}
+
+	file.data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	file.len = (usize)size.QuadPart;
+#else
+	int fd = open(path, O_RDONLY);
+	if(fd < 0) {
+		ERROR_RETURN(file, "Cannot map file: %s\n", path);
+	}
+
+	struct stat info;
+	if(fstat(fd, &info) != 0 || info.st_size == 0) {
+		close(fd);
+		ERROR_RETURN(file, "Cannot map file: %s\n", path);
+	}
+
+	file.data = mmap(NULL, (usize)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if(file.data == MAP_FAILED) {
+		file.data = NULL;
+	}
+	file.len = (usize)info.st_size;
+#endif
+
+	if(!file.data) {
+		ERROR_RETURN(file, "Cannot map file: %s\n", path);
+	}
+
+	file.is_valid = true;
+	return file;
+}
+
+void io_file_unmap(Mapped_File *file) {
+	if(file->is_valid) {
+#ifdef _WIN32
+		UnmapViewOfFile(file->data);
+#else
+		munmap((void*)file->data, file->len);
+#endif
+	}
+
+	*file = (Mapped_File){0};
+}
\ No newline at end of file
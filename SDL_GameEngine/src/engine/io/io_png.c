@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../types.h"
+#include "../util.h"
+#include "../io.h"
+
+// Minimal PNG writer: 8-bit RGBA, no filtering, deflate stored blocks.
+// Files are larger than a real encoder's, but it needs no dependencies and
+// output is byte-for-byte deterministic, which is what golden images want.
+
+#define PNG_STORED_BLOCK_SIZE 65535
+
+static ui32 crc_table[256];
+
+static ui32 crc_update(ui32 crc, const ui8 *data, usize len) {
+	if(crc_table[1] == 0) {
+		for(ui32 n = 0; n < 256; ++n) {
+			ui32 c = n;
+			for(ui32 k = 0; k < 8; ++k) {
+				c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			}
+			crc_table[n] = c;
+		}
+	}
+
+	for(usize i = 0; i < len; ++i) {
+		crc = crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+
+	return crc;
+}
+
+static void put_u32(ui8 *out, ui32 value) {
+	out[0] = (ui8)(value >> 24);
+	out[1] = (ui8)(value >> 16);
+	out[2] = (ui8)(value >> 8);
+	out[3] = (ui8)value;
+}
+
+static void write_chunk(FILE *fp, const char *type, const ui8 *data, usize len) {
+	ui8 header[8];
+	put_u32(header, (ui32)len);
+	memcpy(header + 4, type, 4);
+
+	ui32 crc = crc_update(0xFFFFFFFFu, header + 4, 4);
+	crc = crc_update(crc, data, len) ^ 0xFFFFFFFFu;
+
+	ui8 footer[4];
+	put_u32(footer, crc);
+
+	fwrite(header, 1, 8, fp);
+	fwrite(data, 1, len, fp);
+	fwrite(footer, 1, 4, fp);
+}
+
+// Pixels are RGBA rows from top to bottom. PNG has no empty images.
+int io_png_write(const char *path, const ui8 *pixels, ui32 width, ui32 height) {
+	if(width == 0 || height == 0) {
+		ERROR_RETURN(1, "Cannot write %ux%u PNG: %s\n", width, height, path);
+	}
+
+	usize row_size = (usize)width * 4 + 1;
+	usize raw_size = row_size * height;
+	usize block_count = (raw_size + PNG_STORED_BLOCK_SIZE - 1) / PNG_STORED_BLOCK_SIZE;
+	usize zlib_size = 2 + raw_size + block_count * 5 + 4;
+
+	ui8 *raw = malloc(raw_size);
+	ui8 *zlib = malloc(zlib_size);
+	if(!raw || !zlib) {
+		free(raw);
+		free(zlib);
+		ERROR_RETURN(1, "Not enough memory to write %ux%u PNG: %s\n", width, height, path);
+	}
+
+	for(ui32 y = 0; y < height; ++y) {
+		raw[y * row_size] = 0;
+		memcpy(&raw[y * row_size + 1], &pixels[(usize)y * width * 4], (usize)width * 4);
+	}
+
+	ui8 *out = zlib;
+	*out++ = 0x78;
+	*out++ = 0x01;
+
+	ui32 adler_a = 1;
+	ui32 adler_b = 0;
+
+	for(usize offset = 0; offset < raw_size; offset += PNG_STORED_BLOCK_SIZE) {
+		usize len = raw_size - offset < PNG_STORED_BLOCK_SIZE ? raw_size - offset : PNG_STORED_BLOCK_SIZE;
+
+		*out++ = offset + len == raw_size ? 1 : 0;
+		*out++ = (ui8)len;
+		*out++ = (ui8)(len >> 8);
+		*out++ = (ui8)~len;
+		*out++ = (ui8)(~len >> 8);
+		memcpy(out, &raw[offset], len);
+		out += len;
+
+		for(usize i = 0; i < len; ++i) {
+			adler_a = (adler_a + raw[offset + i]) % 65521;
+			adler_b = (adler_b + adler_a) % 65521;
+		}
+	}
+
+	put_u32(out, adler_b << 16 | adler_a);
+
+	FILE *fp = fopen(path, "wb");
+	if(!fp) {
+		free(raw);
+		free(zlib);
+		ERROR_RETURN(1, "Cannot write file: %s\n", path);
+	}
+
+	static const ui8 signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+	ui8 ihdr[13] = {0};
+	put_u32(ihdr, width);
+	put_u32(ihdr + 4, height);
+	ihdr[8] = 8;
+	ihdr[9] = 6;
+
+	fwrite(signature, 1, 8, fp);
+	write_chunk(fp, "IHDR", ihdr, sizeof(ihdr));
+	write_chunk(fp, "IDAT", zlib, zlib_size);
+	write_chunk(fp, "IEND", NULL, 0);
+
+	int has_error = ferror(fp);
+	fclose(fp);
+	free(raw);
+	free(zlib);
+
+	if(has_error) {
+		ERROR_RETURN(1, "Write error: %s\n", path);
+	}
+
+	return 0;
+}
\ No newline at end of file
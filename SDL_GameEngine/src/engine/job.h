@@ -0,0 +1,13 @@
+#pragma once
+
+#include "types.h"
+
+#define MAX_JOB_THREADS 16
+
+// Called once per slice with the half-open item range [begin, end).
+typedef void (*Job_Function)(void *data, ui32 slice, usize begin, usize end);
+
+void job_init(void);
+void job_shutdown(void);
+ui32 job_thread_count(void);
+void job_parallel_for(usize count, ui32 slice_count, Job_Function function, void *data);
\ No newline at end of file
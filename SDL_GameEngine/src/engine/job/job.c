@@ -0,0 +1,158 @@
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+
+#include "../util.h"
+#include "../job.h"
+
+typedef struct job_state {
+	SDL_Thread *threads[MAX_JOB_THREADS];
+	ui32 worker_count;
+	SDL_mutex *mutex;
+	SDL_mutex *submit_mutex;
+	SDL_cond *work_ready;
+	SDL_cond *work_done;
+	ui32 generation;
+	ui32 active_workers;
+	bool is_quitting;
+
+	Job_Function function;
+	void *data;
+	usize count;
+	ui32 slice_count;
+	SDL_atomic_t next_slice;
+	SDL_atomic_t remaining_slices;
+} Job_State;
+
+static Job_State job;
+
+static void run_slices(void) {
+	for(;;) {
+		i32 slice = SDL_AtomicAdd(&job.next_slice, 1);
+		if(slice >= (i32)job.slice_count) {
+			return;
+		}
+
+		usize begin = job.count * slice / job.slice_count;
+		usize end = job.count * (slice + 1) / job.slice_count;
+		job.function(job.data, (ui32)slice, begin, end);
+
+		if(SDL_AtomicAdd(&job.remaining_slices, -1) == 1) {
+			SDL_LockMutex(job.mutex);
+			SDL_CondBroadcast(job.work_done);
+			SDL_UnlockMutex(job.mutex);
+		}
+	}
+}
+
+static int worker_main(void *data) {
+	(void)data;
+
+	ui32 generation = 0;
+
+	for(;;) {
+		SDL_LockMutex(job.mutex);
+		while(job.generation == generation && !job.is_quitting) {
+			SDL_CondWait(job.work_ready, job.mutex);
+		}
+
+		if(job.is_quitting) {
+			SDL_UnlockMutex(job.mutex);
+			return 0;
+		}
+
+		generation = job.generation;
+		++job.active_workers;
+		SDL_UnlockMutex(job.mutex);
+
+		run_slices();
+
+		SDL_LockMutex(job.mutex);
+		--job.active_workers;
+		SDL_CondBroadcast(job.work_done);
+		SDL_UnlockMutex(job.mutex);
+	}
+}
+
+void job_init(void) {
+	job.mutex = SDL_CreateMutex();
+	job.submit_mutex = SDL_CreateMutex();
+	job.work_ready = SDL_CreateCond();
+	job.work_done = SDL_CreateCond();
+	if(!job.mutex || !job.submit_mutex || !job.work_ready || !job.work_done) {
+		ERROR_EXIT("Could not create job system sync objects: %s\n", SDL_GetError());
+	}
+
+	i32 cpu_count = SDL_GetCPUCount();
+	job.worker_count = cpu_count > 1 ? cpu_count - 1 : 0;
+	if(job.worker_count > MAX_JOB_THREADS - 1) {
+		job.worker_count = MAX_JOB_THREADS - 1;
+	}
+
+	for(ui32 i = 0; i < job.worker_count; ++i) {
+		job.threads[i] = SDL_CreateThread(worker_main, "job_worker", NULL);
+		if(!job.threads[i]) {
+			ERROR_EXIT("Could not create job worker: %s\n", SDL_GetError());
+		}
+	}
+}
+
+void job_shutdown(void) {
+	SDL_LockMutex(job.mutex);
+	job.is_quitting = true;
+	SDL_CondBroadcast(job.work_ready);
+	SDL_UnlockMutex(job.mutex);
+
+	for(ui32 i = 0; i < job.worker_count; ++i) {
+		SDL_WaitThread(job.threads[i], NULL);
+	}
+
+	job.worker_count = 0;
+}
+
+// Worker threads plus the calling thread.
+ui32 job_thread_count(void) {
+	return job.worker_count + 1;
+}
+
+// Splits [0, count) into slice_count contiguous slices and runs them on the
+// workers and the calling thread, returning once every slice is done. Slice
+// i always covers the same range, so results can be stitched back in order.
+// Not reentrant: a job function must not call job_parallel_for. Calls from
+// different threads, such as the main and render threads, take turns.
+void job_parallel_for(usize count, ui32 slice_count, Job_Function function, void *data) {
+	if(count == 0 || slice_count == 0) {
+		return;
+	}
+
+	if(job.worker_count == 0 || slice_count == 1) {
+		for(ui32 slice = 0; slice < slice_count; ++slice) {
+			function(data, slice, count * slice / slice_count, count * (slice + 1) / slice_count);
+		}
+		return;
+	}
+
+	SDL_LockMutex(job.submit_mutex);
+	SDL_LockMutex(job.mutex);
+	while(job.active_workers > 0) {
+		SDL_CondWait(job.work_done, job.mutex);
+	}
+
+	job.function = function;
+	job.data = data;
+	job.count = count;
+	job.slice_count = slice_count;
+	SDL_AtomicSet(&job.next_slice, 0);
+	SDL_AtomicSet(&job.remaining_slices, (i32)slice_count);
+	++job.generation;
+	SDL_CondBroadcast(job.work_ready);
+	SDL_UnlockMutex(job.mutex);
+
+	run_slices();
+
+	SDL_LockMutex(job.mutex);
+	while(SDL_AtomicGet(&job.remaining_slices) > 0) {
+		SDL_CondWait(job.work_done, job.mutex);
+	}
+	SDL_UnlockMutex(job.mutex);
+	SDL_UnlockMutex(job.submit_mutex);
+}
\ No newline at end of file
@@ -7,31 +7,170 @@
 
 typedef struct batch_vertex {
 	vec2 position;
-	vec2 uvs;
-	vec4 color;
-	f32 texture_slot;
+	ui16 uvs[2];
+	ui8 color[4];
+	ui16 texture_slot;
+	ui16 order;
 } Batch_Vertex;
 
+typedef enum render_blend_mode {
+	RENDER_BLEND_ALPHA,
+	RENDER_BLEND_ADDITIVE,
+	RENDER_BLEND_PREMULTIPLIED
+} Render_Blend_Mode;
+
+typedef enum render_video_format {
+	RENDER_VIDEO_RAW,
+	RENDER_VIDEO_PNG,
+	RENDER_VIDEO_Y4M
+} Render_Video_Format;
+
+typedef struct sprite_instance {
+	vec2 position;
+	vec2 size;
+	// u0, v0, u1, v1, each in [0, 1]. Textures do not repeat within a
+	// sprite.
+	vec4 uvs;
+	vec4 color;
+	ui32 texture_id;
+	// Palette to resolve an indexed texture with, 0 for RGBA textures.
+	ui16 palette;
+	// Palette is_opaque was worked out with. Drawn with any other palette
+	// the sprite is blended, since the variant may change alpha.
+	ui16 opaque_palette;
+	bool is_opaque;
+	// The texture has premultiplied alpha. Such sprites drawn with
+	// RENDER_BLEND_ALPHA blend as RENDER_BLEND_PREMULTIPLIED instead, with
+	// their tint premultiplied to match.
+	bool is_premultiplied;
+} Sprite_Instance;
+
+typedef struct render_mesh {
+	ui32 id;
+	ui32 quad_count;
+} Render_Mesh;
+
+typedef enum render_pass {
+	RENDER_PASS_STATIC,
+	RENDER_PASS_MESHES,
+	RENDER_PASS_OPAQUE,
+	RENDER_PASS_TRANSLUCENT,
+	RENDER_PASS_COUNT
+} Render_Pass;
+
+// gpu_ms is resolved RENDER_QUERY_LATENCY frames after the frame it times,
+// so reading it never waits on the GPU. The software backend reports its
+// rasterizer's CPU time there instead.
+typedef struct render_stats {
+	ui32 draw_calls;
+	ui32 quads;
+	ui32 vertices_uploaded;
+	ui32 bytes_uploaded;
+	ui32 state_changes;
+	ui32 state_changes_skipped;
+	ui32 flushes;
+	f32 gpu_ms[RENDER_PASS_COUNT];
+} Render_Stats;
+
+typedef struct render_state_counters {
+	ui32 issued;
+	ui32 skipped;
+} Render_State_Counters;
+
+// Bounds are the cell's non-transparent pixels, [x0, x1) by [y0, y1)
+// from its bottom left. Sprites are drawn trimmed to them. An empty cell
+// has empty bounds.
+typedef struct sprite_cell {
+	ui16 x0;
+	ui16 y0;
+	ui16 x1;
+	ui16 y1;
+	bool is_opaque;
+} Sprite_Cell;
+
 typedef struct sprite_sheet {
 	f32 width;
 	f32 height;
 	f32 cell_width;
 	f32 cell_height;
 	ui32 texture_id;
+	ui32 row_count;
+	ui32 column_count;
+	Sprite_Cell *cells;
+	// Set for cooked textures with premultiplied alpha, which are drawn
+	// with RENDER_BLEND_PREMULTIPLIED.
+	bool is_premultiplied;
+	// Set for indexed sheets: the palette built from the image's colours.
+	ui16 palette;
 } Sprite_Sheet;
 
-#define MAX_BATCH_QUADS 10000
-#define MAX_BATCH_VERTICES 40000
-#define MAX_BATCH_ELEMENTS 60000
+// Indexed textures hold one byte per texel that picks a colour from the
+// sprite's palette, so colour variants need only another palette.
+#define RENDER_PALETTE_SIZE 256
+#define MAX_RENDER_PALETTES 256
+
+// Quads per draw call, sized so 16-bit indices can address every vertex.
+#define MAX_BATCH_QUADS 16384
+#define MAX_BATCH_VERTICES 65536
+#define MAX_BATCH_ELEMENTS 98304
+
+#define RENDER_QUERY_LATENCY 4
+#define RENDER_STATS_HISTORY 120
+
+// Sprites can be recorded from this many threads at once, one recorder each.
+#define MAX_RENDER_RECORDERS 16
 
 SDL_Window *render_init(void);
+SDL_Window *render_init_headless(void);
+SDL_Window *render_init_software(bool is_headless);
+const ui8 *render_soft_pixels(void);
 void render_begin(void);
-void render_end(SDL_Window *window, ui32 batch_texture_ids[8]);
+void render_end(SDL_Window *window);
+void render_thread_start(SDL_Window *window);
+void render_thread_stop(void);
+void render_shutdown(void);
+void render_capture_begin(const char *path, ui32 frame_count);
+void render_video_begin(const char *path, Render_Video_Format format, ui32 frame_rate);
+void render_video_end(void);
+void render_screenshot(const char *path);
+void render_set_dynamic_resolution(bool is_enabled, f32 budget_ms);
+void render_set_sort_mode(bool sorted);
+void render_set_layer(ui8 layer);
+void render_set_depth(ui16 depth);
+void render_set_blend_mode(Render_Blend_Mode blend_mode);
+bool render_static_begin(void);
+void render_static_end(void);
+void render_static_invalidate(void);
 void render_quad(vec2 pos, vec2 size, vec4 color);
 void render_quad_line(vec2 pos, vec2 size, vec4 color);
 void render_line_segment(vec2 start, vec2 end, vec4 color);
 void render_aabb(f32 *aabb, vec4 color);
+void render_set_line_width(f32 width);
 f32 render_get_scale();
+Render_Stats render_stats(void);
+void render_stats_history(Render_Stats result[RENDER_STATS_HISTORY]);
+void render_stats_text(ui32 font, vec2 position);
+Render_State_Counters render_state_counters(void);
+void render_state_counters_reset(void);
 
 void render_sprite_sheet_init(Sprite_Sheet *sprite_sheet, const char *path, f32 cell_width, f32 cell_height);
-void render_sprite_sheet_frame(Sprite_Sheet *sprite_sheet, f32 row, f32 column, vec2 position, bool is_flipped, vec4 color, ui32 texture_slots[8]);
\ No newline at end of file
+void render_sprite_sheet_load(Sprite_Sheet *sprite_sheet, const char *path, f32 cell_width, f32 cell_height);
+void render_sprite_sheet_init_indexed(Sprite_Sheet *sprite_sheet, const char *path, f32 cell_width, f32 cell_height);
+ui16 render_palette_create(const vec4 *colors, ui32 count);
+ui16 render_palette_copy(ui16 palette);
+void render_palette_replace(ui16 palette, vec4 from, vec4 to);
+ui32 render_font_load(const char *path, ui32 pixel_size);
+f32 render_font_line_height(ui32 font);
+f32 render_text_width(ui32 font, const char *text);
+void render_text(ui32 font, const char *text, vec2 position, vec4 color);
+ui32 render_sprite_sheet_pending(void);
+void render_sprite_sheet_frame(Sprite_Sheet *sprite_sheet, f32 row, f32 column, vec2 position, bool is_flipped, vec4 color);
+bool render_sprite_sheet_instance(Sprite_Instance *sprite, const Sprite_Sheet *sprite_sheet, f32 row, f32 column, vec2 position, bool is_flipped, vec4 color);
+void render_sprites(const Sprite_Instance *sprites, usize count);
+void render_record_begin(void);
+void render_record_sprites(ui32 recorder, const Sprite_Instance *sprites, usize count);
+void render_record_end(void);
+
+void render_mesh_upload(Render_Mesh *mesh, const Sprite_Instance *sprites, usize count);
+void render_mesh(const Render_Mesh *mesh, ui32 texture_id);
+void render_mesh_destroy(Render_Mesh *mesh);
\ No newline at end of file
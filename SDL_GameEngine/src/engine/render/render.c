@@ -1,4 +1,5 @@
 #include <glad/glad.h>
+#include <float.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -8,41 +9,216 @@
 #include "../util.h"
 #include "render_internal.h"
 #include "../array_list.h"
+#include "../camera.h"
+#include "../job.h"
+#include "../io.h"
 
 static f32 window_width = 1920;
 static f32 window_height = 1080;
 static f32 render_width = 640;
 static f32 render_height = 360;
 static f32 scale = 3;
+static f32 line_width = 1;
 
 static ui32 vao_quad;
 static ui32 vbo_quad;
 static ui32 ebo_quad;
-static ui32 vao_line;
-static ui32 vbo_line;
 static ui32 shader_default;
 static ui32 texture_color;
 static ui32 vao_batch;
 static ui32 vbo_batch;
 static ui32 ebo_batch;
-static ui32 shader_batch;
-static Array_List *list_batch;
+static ui32 shader_batch[RENDER_SHADER_VARIANT_COUNT];
+static ui32 shader_batch_serial[RENDER_SHADER_VARIANT_COUNT];
+static mat4x4 batch_projection;
+static ui32 batch_projection_serial;
+static Render_Frame frames[2];
+static Render_Frame *frame = &frames[0];
+static mat4x4 frame_projection;
+static Array_List *list_payload;
+static Array_List *list_mesh_quads;
+static Array_List *list_mesh_buffers;
+static Array_List *list_free_mesh_ids;
+static ui32 mesh_id_count;
+static Array_List *list_sorted_batch;
+static Array_List *list_sorted_quads;
+static Array_List *list_sort_keys;
+static Array_List *list_sort_indices;
 
-SDL_Window *render_init(void) {
-	SDL_Window *window = render_init_window(window_width, window_height);
+static bool is_sorted = false;
+static bool is_software = false;
+static ui8 current_layer;
+static ui16 current_depth;
+static Render_Blend_Mode current_blend_mode;
+static vec4 view_rect;
+
+#define STATIC_LAYER_MARGIN 64
+
+typedef struct static_layer {
+	ui32 fbo;
+	ui32 texture;
+	ui32 depth;
+	ui32 width;
+	ui32 height;
+	vec4 rect;
+	f32 zoom;
+	usize first_quad;
+	bool is_valid;
+	bool is_building;
+} Static_Layer;
+
+static Static_Layer static_layer;
+
+typedef struct frame_target {
+	ui32 fbo;
+	ui32 texture;
+	ui32 depth;
+	ui32 width;
+	ui32 height;
+} Frame_Target;
+
+// Where frames are shown: the window's framebuffer (0), or an offscreen
+// one when headless.
+static Frame_Target frame_target;
+
+// Where frames are drawn: the logical resolution, or less under dynamic
+// resolution. It is upscaled to frame_target by a whole factor, so pixel
+// art comes out the same while the window's pixels are shaded only once.
+static Frame_Target scene_target;
+
+// Each level adds one to the upscale factor, so at 1920x1080 the scene
+// is 640x360, 480x270, 384x216, then 320x180.
+#define DYNAMIC_RESOLUTION_LEVELS 4
+#define DYNAMIC_RESOLUTION_COOLDOWN 60
+
+typedef struct dynamic_resolution {
+	f32 budget_ms;
+	f32 average_ms;
+	ui32 level;
+	ui32 cooldown;
+	bool is_enabled;
+} Dynamic_Resolution;
+
+static Dynamic_Resolution dynamic_resolution;
+
+// Below this many sprites splitting the work costs more than it saves.
+#define PARALLEL_SPRITE_THRESHOLD 4096
+
+typedef struct sprite_job {
+	const Sprite_Instance *sprites;
+	Batch_Quad quad;
+	Batch_Vertex *vertices;
+	Batch_Quad *quads;
+	usize begin[MAX_RENDER_RECORDERS];
+	usize emitted[MAX_RENDER_RECORDERS];
+} Sprite_Job;
+
+typedef struct render_recorder {
+	Array_List *vertices;
+	Array_List *quads;
+} Render_Recorder;
+
+static Render_Recorder recorders[MAX_RENDER_RECORDERS];
+static Batch_Quad recorder_quad;
+
+typedef struct mesh_upload {
+	ui32 id;
+	ui32 quad_count;
+} Mesh_Upload;
+
+typedef struct static_build {
+	vec4 rect;
+	f32 zoom;
+	ui32 quad_count;
+	bool is_sorted;
+} Static_Build;
+
+static void init_lists(void);
+
+static SDL_Window *init(bool is_headless) {
+	SDL_Window *window = render_init_window(window_width, window_height, is_headless);
+
+	render_state_init();
 
 	render_init_quad(&vao_quad, &vbo_quad, &ebo_quad);
 	render_init_batch_quads(&vao_batch, &vbo_batch, &ebo_batch);
-	render_init_line(&vao_line, &vbo_line);
-	render_init_shaders(&shader_default, &shader_batch, render_width, render_height);
+	render_init_shaders(&shader_default, shader_batch);
 	render_init_color_texture(&texture_color);
+	render_init_render_target(&static_layer.fbo, &static_layer.texture, &static_layer.depth, 1, 1);
+	render_init_render_target(&scene_target.fbo, &scene_target.texture, &scene_target.depth, render_width, render_height);
+	scene_target.width = render_width;
+	scene_target.height = render_height;
+	camera_init(render_width, render_height);
+
+	if(is_headless) {
+		render_init_render_target(&frame_target.fbo, &frame_target.texture, &frame_target.depth, window_width, window_height);
+	}
+
+	frame_target.width = window_width;
+	frame_target.height = window_height;
 
 	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	render_state_blend_mode(RENDER_BLEND_ALPHA);
+
+	init_lists();
+	render_palette_init(false);
+	render_text_init(false);
+
+	return window;
+}
+
+static void init_lists(void) {
+	for(ui32 i = 0; i < 2; ++i) {
+		frames[i].vertices = array_list_create(sizeof(Batch_Vertex), MAX_BATCH_VERTICES);
+		frames[i].quads = array_list_create(sizeof(Batch_Quad), MAX_BATCH_QUADS);
+		frames[i].meshes = array_list_create(sizeof(Mesh_Draw), 0);
+		frames[i].commands = array_list_create(1, 0);
+	}
 
-	list_batch = array_list_create(sizeof(Batch_Vertex), 8);
+	list_sorted_batch = array_list_create(sizeof(Batch_Vertex), MAX_BATCH_VERTICES);
+	list_sorted_quads = array_list_create(sizeof(Batch_Quad), MAX_BATCH_QUADS);
+	list_sort_keys = array_list_create(sizeof(ui64), MAX_BATCH_QUADS * 2);
+	list_sort_indices = array_list_create(sizeof(ui32), MAX_BATCH_QUADS * 2);
+	list_payload = array_list_create(1, 0);
+	list_mesh_quads = array_list_create(sizeof(Batch_Quad), 0);
+	list_mesh_buffers = array_list_create(sizeof(Mesh_Buffers), 1);
+	list_free_mesh_ids = array_list_create(sizeof(ui32), 0);
+
+	for(ui32 i = 0; i < MAX_RENDER_RECORDERS; ++i) {
+		recorders[i].vertices = array_list_create(sizeof(Batch_Vertex), 0);
+		recorders[i].quads = array_list_create(sizeof(Batch_Quad), 0);
+	}
 
 	stbi_set_flip_vertically_on_load(1);
+}
+
+SDL_Window *render_init(void) {
+	return init(false);
+}
+
+// Renders into an offscreen framebuffer instead of a visible window. The
+// context comes from SDL's offscreen video driver (EGL pbuffer), so this
+// runs on machines without a display or GPU, e.g. on Mesa llvmpipe.
+SDL_Window *render_init_headless(void) {
+	return init(true);
+}
+
+// Draws with the CPU instead of GL, for machines without a GPU. The
+// rest of the API is unchanged, except that the static layer is drawn
+// as regular quads each frame and captures are not recorded. Frames are
+// drawn at the logical resolution, or less under dynamic resolution, shown
+// upscaled on the window's surface and read back with render_soft_pixels.
+SDL_Window *render_init_software(bool is_headless) {
+	SDL_Window *window = render_init_window_software(window_width, window_height, is_headless);
+
+	is_software = true;
+	render_soft_init(render_width, render_height);
+	scene_target.width = render_width;
+	scene_target.height = render_height;
+	camera_init(render_width, render_height);
+	init_lists();
+	render_palette_init(true);
+	render_text_init(true);
 
 	return window;
 }
@@ -73,129 +249,903 @@ static i32 try_insert_texture(ui32 texture_slots[8], ui32 texture_id) {
 	return -1;
 }
 
-void render_begin(void) {
+// Batch variants are given the projection when next bound, so only the
+// few a frame draws with upload it.
+static void set_projection(mat4x4 projection) {
+	render_state_use_program(shader_default);
+	glUniformMatrix4fv(render_state_uniform_location(shader_default, "projection"), 1, GL_FALSE, &projection[0][0]);
+
+	mat4x4_dup(batch_projection, projection);
+	++batch_projection_serial;
+}
+
+static void use_batch_shader(ui32 features) {
+	render_state_use_program(shader_batch[features]);
+
+	if(shader_batch_serial[features] != batch_projection_serial) {
+		glUniformMatrix4fv(render_state_uniform_location(shader_batch[features], "projection"), 1, GL_FALSE, &batch_projection[0][0]);
+		shader_batch_serial[features] = batch_projection_serial;
+	}
+}
+
+static void bind_scene_target(void) {
+	glBindFramebuffer(GL_FRAMEBUFFER, scene_target.fbo);
+	glViewport(0, 0, scene_target.width, scene_target.height);
+}
+
+static void frame_begin_gl(Render_Frame *target) {
+	ui32 upscale = target->upscale ? target->upscale : (ui32)scale;
+	ui32 width = frame_target.width / upscale;
+	ui32 height = frame_target.height / upscale;
+
+	if(width != scene_target.width || height != scene_target.height) {
+		render_init_render_target(&scene_target.fbo, &scene_target.texture, &scene_target.depth, width, height);
+		scene_target.width = width;
+		scene_target.height = height;
+	}
+
+	bind_scene_target();
 	glClearColor(0.08, 0.1, 0.1, 1);
-	glClear(GL_COLOR_BUFFER_BIT);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	render_stats_frame_begin(&target->stats);
+	mat4x4_dup(frame_projection, target->projection);
+	set_projection(frame_projection);
+}
+
+// The software target stands in for scene_target, at the same size.
+static void frame_begin_soft(Render_Frame *target) {
+	ui32 upscale = target->upscale ? target->upscale : (ui32)scale;
+	scene_target.width = (ui32)(render_width * scale / upscale);
+	scene_target.height = (ui32)(render_height * scale / upscale);
 
-	list_batch->len = 0;
+	render_soft_resize(scene_target.width, scene_target.height);
+	render_stats_frame_begin_soft(&target->stats);
 }
 
-static void render_batch(Batch_Vertex *vertices, usize count, ui32 texture_ids[8]) {
+// Anything that touches GL after render_begin goes through a command. With
+// the render thread running it is copied into the frame and run there,
+// otherwise it runs straight away.
+void render_command_submit(Render_Command_Function function, const void *payload, usize size) {
+	if(render_thread_is_running()) {
+		render_command_push(frame->commands, function, payload, size);
+	} else {
+		function(payload);
+	}
+}
+
+void render_begin(void) {
+	frame->vertices->len = 0;
+	frame->quads->len = 0;
+	frame->meshes->len = 0;
+	frame->upscale = (ui8)(scale + dynamic_resolution.level);
+	current_layer = 0;
+	current_depth = 0;
+	current_blend_mode = RENDER_BLEND_ALPHA;
+
+	camera_view_projection(frame->projection);
+	camera_view_rect(view_rect);
+	render_texture_uploads();
+	render_text_frame_begin();
+
+	if(!render_thread_is_running()) {
+		if(is_software) {
+			frame_begin_soft(frame);
+		} else {
+			frame_begin_gl(frame);
+		}
+	}
+}
+
+static bool is_visible(f32 x0, f32 y0, f32 x1, f32 y1) {
+	return x1 >= view_rect[0] && y1 >= view_rect[1] && x0 <= view_rect[2] && y0 <= view_rect[3];
+}
+
+static void render_batch(Batch_Vertex *vertices, usize count, ui32 texture_ids[8], Render_Blend_Mode blend_mode, ui32 features) {
 	glBindBuffer(GL_ARRAY_BUFFER, vbo_batch);
 	glBufferSubData(GL_ARRAY_BUFFER, 0 , count * sizeof(Batch_Vertex), vertices);
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, texture_color);
+	// Untextured variants output the vertex colour and sample nothing.
+	// Untextured quads only reach the opaque pass at full alpha, so they
+	// never need the alpha test.
+	if(!(features & RENDER_SHADER_TEXTURED)) {
+		features = RENDER_SHADER_TINTED;
+	} else {
+		render_state_bind_texture(0, texture_color);
 
-	for(ui32 i = 1; i < 8; ++i) {
-		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, texture_ids[i]);
+		for(ui32 i = 1; i < 8; ++i) {
+			render_state_bind_texture(i, texture_ids[i]);
+		}
+
+		if(features & RENDER_SHADER_PALETTED) {
+			render_state_bind_texture(RENDER_PALETTE_UNIT, render_palette_texture());
+		}
 	}
 
-	glUseProgram(shader_batch);
-	glBindVertexArray(vao_batch);
+	render_state_blend_mode(blend_mode);
+	use_batch_shader(features);
+	render_state_bind_vertex_array(vao_batch);
 
-	glDrawElements(GL_TRIANGLES, (count >> 2) * 6, GL_UNSIGNED_INT, NULL);
+	glDrawElements(GL_TRIANGLES, (count >> 2) * 6, GL_UNSIGNED_SHORT, NULL);
+
+	render_stats_draw((ui32)(count >> 2));
+	render_stats_upload((ui32)count, count * sizeof(Batch_Vertex));
 }
 
-static void append_quad(vec2 position, vec2 size, vec4 texture_coordinates, vec4 color, f32 texture_slot) {
-	vec4 uvs = {0, 0, 1, 1};
+static Batch_Quad current_quad(void) {
+	return (Batch_Quad){
+		.depth = current_depth,
+		.layer = current_layer,
+		.blend_mode = current_blend_mode,
+		.is_opaque = current_blend_mode == RENDER_BLEND_ALPHA
+	};
+}
 
-	if(texture_coordinates != NULL) {
-		memcpy(uvs, texture_coordinates, sizeof(vec4));
+static void append_vertices(vec2 corners[4], vec4 uvs, vec4 color, ui32 texture_id) {
+	Batch_Vertex *vertices = array_list_append_n(frame->vertices, 4);
+	Batch_Quad *quad = array_list_append_n(frame->quads, 1);
+	if(!vertices || !quad) {
+		ERROR_EXIT("Could not append quad to batch\n");
 	}
 
-	array_list_append(list_batch, &(Batch_Vertex){ 
-		.position = {position[0], position[1]},
-		.uvs = {uvs[0], uvs[1]},
-		.color = {color[0], color[1], color[2], color[3]},
-		.texture_slot = texture_slot
-	});
+	*quad = current_quad();
+	quad->texture_id = texture_id;
+	quad->is_opaque = quad->is_opaque && texture_id == 0 && color[3] >= 1;
 
-	array_list_append(list_batch, &(Batch_Vertex){ 
-		.position = {position[0] + size[0], position[1]},
-		.uvs = {uvs[2], uvs[1]},
-		.color = {color[0], color[1], color[2], color[3]},
-		.texture_slot = texture_slot
-	});
+	for(ui32 i = 0; i < 4; ++i) {
+		vertices[i] = (Batch_Vertex){
+			.position = {corners[i][0], corners[i][1]},
+			.uvs = {
+				render_pack_unorm16(uvs[i == 0 || i == 3 ? 0 : 2]),
+				render_pack_unorm16(uvs[i < 2 ? 1 : 3])
+			},
+			.color = {
+				render_pack_unorm8(color[0]),
+				render_pack_unorm8(color[1]),
+				render_pack_unorm8(color[2]),
+				render_pack_unorm8(color[3])
+			}
+		};
+	}
+}
 
-	array_list_append(list_batch, &(Batch_Vertex){ 
-		.position = {position[0] + size[0], position[1] + size[1]},
-		.uvs = {uvs[2], uvs[3]},
-		.color = {color[0], color[1], color[2], color[3]},
-		.texture_slot = texture_slot
-	});
+static void emit_sprites_job(void *data, ui32 slice, usize begin, usize end) {
+	Sprite_Job *job = data;
 
-	array_list_append(list_batch, &(Batch_Vertex){ 
-		.position = {position[0], position[1] + size[1]},
-		.uvs = {uvs[0], uvs[3]},
-		.color = {color[0], color[1], color[2], color[3]},
-		.texture_slot = texture_slot
-	});
+	job->begin[slice] = begin;
+	job->emitted[slice] = render_batch_emit_sprites(job->sprites + begin, end - begin, view_rect, &job->quad, job->vertices + begin * 4, job->quads + begin);
 }
 
-void render_end(SDL_Window *window, ui32 batch_texture_ids[8]) {
-	render_batch(list_batch->items, list_batch->len, batch_texture_ids);
+// Large submissions are split into slices emitted on the job threads, then
+// the culled gaps between slices are closed up in slice order.
+static usize emit_sprites_parallel(const Sprite_Instance *sprites, usize count, Batch_Vertex *vertices, Batch_Quad *quads) {
+	ui32 slice_count = job_thread_count();
+	if(slice_count > MAX_RENDER_RECORDERS) {
+		slice_count = MAX_RENDER_RECORDERS;
+	}
+
+	Sprite_Job job = {
+		.sprites = sprites,
+		.quad = current_quad(),
+		.vertices = vertices,
+		.quads = quads
+	};
+
+	job_parallel_for(count, slice_count, emit_sprites_job, &job);
+
+	usize emitted = job.emitted[0];
+
+	for(ui32 i = 1; i < slice_count; ++i) {
+		memmove(&vertices[emitted * 4], &vertices[job.begin[i] * 4], job.emitted[i] * 4 * sizeof(Batch_Vertex));
+		memmove(&quads[emitted], &quads[job.begin[i]], job.emitted[i] * sizeof(Batch_Quad));
+		emitted += job.emitted[i];
+	}
 
-	SDL_GL_SwapWindow(window);
+	return emitted;
 }
 
-void render_quad(vec2 pos, vec2 size, vec4 color) {
-	glUseProgram(shader_default);
+void render_sprites(const Sprite_Instance *sprites, usize count) {
+	Batch_Vertex *vertices = array_list_append_n(frame->vertices, count * 4);
+	Batch_Quad *quads = array_list_append_n(frame->quads, count);
+	if(!vertices || !quads) {
+		ERROR_EXIT("Could not append sprites to batch\n");
+	}
 
-	mat4x4 model;
-	mat4x4_identity(model);
+	usize emitted;
+	if(count >= PARALLEL_SPRITE_THRESHOLD) {
+		emitted = emit_sprites_parallel(sprites, count, vertices, quads);
+	} else {
+		Batch_Quad quad = current_quad();
+		emitted = render_batch_emit_sprites(sprites, count, view_rect, &quad, vertices, quads);
+	}
 
-	mat4x4_translate(model, pos[0], pos[1], 0);
-	mat4x4_scale_aniso(model, model, size[0], size[1], 1);
+	usize culled = count - emitted;
+	frame->vertices->len -= culled * 4;
+	frame->quads->len -= culled;
+}
 
-	glUniformMatrix4fv(glGetUniformLocation(shader_default, "model"), 1, GL_FALSE, &model[0][0]);
-	glUniform4fv(glad_glGetUniformLocation(shader_default, "color"), 1, color);
+// Recording lets other threads build sprites while the main thread waits.
+// Between render_record_begin and render_record_end each thread writes to
+// its own recorder, and the main thread must not submit or change render
+// state. render_record_end appends the recorders in index order, so the
+// result does not depend on which thread finished first.
+void render_record_begin(void) {
+	recorder_quad = current_quad();
 
-	glBindVertexArray(vao_quad);
+	for(ui32 i = 0; i < MAX_RENDER_RECORDERS; ++i) {
+		recorders[i].vertices->len = 0;
+		recorders[i].quads->len = 0;
+	}
+}
 
-	glBindTexture(GL_TEXTURE_2D, texture_color);
-	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, NULL);
+void render_record_sprites(ui32 recorder, const Sprite_Instance *sprites, usize count) {
+	if(recorder >= MAX_RENDER_RECORDERS) {
+		ERROR_EXIT("Recorder %u is out of range, the limit is %u\n", recorder, MAX_RENDER_RECORDERS);
+	}
+
+	Render_Recorder *target = &recorders[recorder];
+	Batch_Vertex *vertices = array_list_append_n(target->vertices, count * 4);
+	Batch_Quad *quads = array_list_append_n(target->quads, count);
+	if(!vertices || !quads) {
+		ERROR_EXIT("Could not append sprites to recorder %u\n", recorder);
+	}
+
+	usize culled = count - render_batch_emit_sprites(sprites, count, view_rect, &recorder_quad, vertices, quads);
 
-	glBindVertexArray(0);
+	target->vertices->len -= culled * 4;
+	target->quads->len -= culled;
 }
 
-void render_line_segment(vec2 start, vec2 end, vec4 color) {
-	glUseProgram(shader_default);
-	glLineWidth(3);
+void render_record_end(void) {
+	for(ui32 i = 0; i < MAX_RENDER_RECORDERS; ++i) {
+		usize count = recorders[i].quads->len;
+		if(count > 0) {
+			render_batch_append(recorders[i].vertices->items, recorders[i].quads->items, count);
+		}
+	}
+}
+
+// Appends quads emitted earlier, as they were.
+void render_batch_append(const Batch_Vertex *source_vertices, const Batch_Quad *source_quads, usize count) {
+	Batch_Vertex *vertices = array_list_append_n(frame->vertices, count * 4);
+	Batch_Quad *quads = array_list_append_n(frame->quads, count);
+	if(!vertices || !quads) {
+		ERROR_EXIT("Could not append %zu quads to batch\n", count);
+	}
+
+	memcpy(vertices, source_vertices, count * 4 * sizeof(Batch_Vertex));
+	memcpy(quads, source_quads, count * sizeof(Batch_Quad));
+}
+
+// Quads in the frame so far. Those appended after a mark can be read
+// back with render_batch_range and kept to append again.
+usize render_batch_mark(void) {
+	return frame->quads->len;
+}
+
+usize render_batch_range(usize first, const Batch_Vertex **vertices, const Batch_Quad **quads) {
+	*vertices = (const Batch_Vertex*)frame->vertices->items + first * 4;
+	*quads = (const Batch_Quad*)frame->quads->items + first;
+
+	return frame->quads->len - first;
+}
+
+// What new quads would take from the render state, which kept quads must
+// match to stand in for them.
+void render_batch_state(Batch_Quad *quad) {
+	*quad = current_quad();
+}
+
+// With culling off every quad is emitted, so quads kept past this frame
+// hold whatever part of them the camera shows later.
+void render_batch_cull(bool is_enabled) {
+	if(is_enabled) {
+		camera_view_rect(view_rect);
+	} else {
+		view_rect[0] = view_rect[1] = -FLT_MAX;
+		view_rect[2] = view_rect[3] = FLT_MAX;
+	}
+}
+
+// Keeps the palette bits above the slot.
+static void set_texture_slot(Batch_Vertex *vertices, ui32 texture_slot) {
+	for(ui32 i = 0; i < 4; ++i) {
+		vertices[i].texture_slot = (vertices[i].texture_slot & ~RENDER_TEXTURE_SLOT_MASK) | texture_slot;
+	}
+}
+
+static bool is_tinted(const Batch_Vertex *vertices) {
+	const ui8 *color = vertices[0].color;
+	return (color[0] & color[1] & color[2] & color[3]) != 255;
+}
+
+// Draws quads in order, splitting into batches on blend mode, texture
+// slots and size. Each batch uses the cheapest shader variant that covers
+// its quads, on top of the given base features.
+static void flush_batch(Batch_Vertex *vertices, Batch_Quad *quads, usize quad_count, ui32 base_features) {
+	ui32 texture_ids[8] = {0};
+	usize start = 0;
+	ui32 features = base_features;
+
+	render_stats_flush();
+
+	for(usize i = 0; i < quad_count; ++i) {
+		if(i - start == MAX_BATCH_QUADS || (i > start && quads[i].blend_mode != quads[start].blend_mode)) {
+			render_batch(vertices + start * 4, (i - start) * 4, texture_ids, quads[start].blend_mode, features);
+			start = i;
+			features = base_features;
+		}
+
+		i32 texture_slot = 0;
+
+		if(quads[i].texture_id != 0) {
+			texture_slot = try_insert_texture(texture_ids, quads[i].texture_id);
+
+			if(texture_slot == -1) {
+				render_batch(vertices + start * 4, (i - start) * 4, texture_ids, quads[start].blend_mode, features);
+				memset(texture_ids, 0, sizeof(texture_ids));
+				start = i;
+				features = base_features;
+
+				texture_slot = try_insert_texture(texture_ids, quads[i].texture_id);
+			}
+
+			features |= RENDER_SHADER_TEXTURED;
+
+			if(vertices[i * 4].texture_slot >> RENDER_PALETTE_SHIFT) {
+				features |= RENDER_SHADER_PALETTED;
+			}
+		}
+
+		if(is_tinted(&vertices[i * 4])) {
+			features |= RENDER_SHADER_TINTED;
+		}
+
+		set_texture_slot(&vertices[i * 4], (ui32)texture_slot);
+	}
+
+	if(start < quad_count) {
+		render_batch(vertices + start * 4, (quad_count - start) * 4, texture_ids, quads[start].blend_mode, features);
+	}
+}
+
+static ui64 sort_key(Batch_Quad *quad) {
+	return (ui64)quad->layer << 56 |
+		(ui64)quad->blend_mode << 48 |
+		(ui64)quad->texture_id << 16 |
+		(ui64)quad->depth;
+}
+
+static void set_order(Batch_Vertex *vertices, ui16 order) {
+	vertices[0].order = order;
+	vertices[1].order = order;
+	vertices[2].order = order;
+	vertices[3].order = order;
+}
+
+static void gather_quad(Batch_Vertex *vertices, Batch_Quad *quads, usize destination, usize source) {
+	Batch_Vertex *sorted_vertices = list_sorted_batch->items;
+	Batch_Quad *sorted_quads = list_sorted_quads->items;
+
+	memcpy(&sorted_vertices[destination * 4], &vertices[source * 4], 4 * sizeof(Batch_Vertex));
+	sorted_quads[destination] = quads[source];
+}
+
+// Back-to-front order of a range of quads: submission order, or by sort
+// key when sorted.
+static ui32 *painter_order(Batch_Quad *quads, usize quad_count, bool sorted) {
+	list_sort_keys->len = 0;
+	list_sort_indices->len = 0;
+	ui64 *keys = array_list_append_n(list_sort_keys, quad_count * 2);
+	ui32 *indices = array_list_append_n(list_sort_indices, quad_count * 2);
+	if(!keys || !indices) {
+		ERROR_EXIT("Could not allocate sort buffers\n");
+	}
+
+	for(usize i = 0; i < quad_count; ++i) {
+		indices[i] = (ui32)i;
+	}
+
+	ui32 *painter = indices;
+	if(sorted) {
+		for(usize i = 0; i < quad_count; ++i) {
+			keys[i] = sort_key(&quads[i]);
+		}
+
+		painter = render_batch_radix_sort(keys, indices, keys + quad_count, indices + quad_count, quad_count);
+	}
+
+	return painter;
+}
+
+// Puts a range of quads into draw order: opaque quads front-to-back, then
+// translucent quads back-to-front. Each quad gets its back-to-front rank
+// as depth so both passes agree on what covers what. Returns the number
+// of opaque quads at the start of the sorted lists.
+static usize order_batch(Batch_Vertex *vertices, Batch_Quad *quads, usize quad_count, bool sorted) {
+	ui32 *painter = painter_order(quads, quad_count, sorted);
+	usize opaque_count = 0;
+
+	for(usize i = 0; i < quad_count; ++i) {
+		ui16 order = quad_count <= 0x10000 ? (ui16)i : (ui16)(i * 0xFFFF / (quad_count - 1));
+		set_order(&vertices[painter[i] * 4], order);
+
+		if(quads[painter[i]].is_opaque) {
+			++opaque_count;
+		}
+	}
+
+	list_sorted_batch->len = 0;
+	list_sorted_quads->len = 0;
+	if(!array_list_append_n(list_sorted_batch, quad_count * 4) || !array_list_append_n(list_sorted_quads, quad_count)) {
+		ERROR_EXIT("Could not allocate sorted batch\n");
+	}
+
+	usize opaque = 0;
+	usize translucent = opaque_count;
+
+	for(usize i = quad_count; i > 0; --i) {
+		if(quads[painter[i - 1]].is_opaque) {
+			gather_quad(vertices, quads, opaque++, painter[i - 1]);
+		}
+	}
+
+	for(usize i = 0; i < quad_count; ++i) {
+		if(!quads[painter[i]].is_opaque) {
+			gather_quad(vertices, quads, translucent++, painter[i]);
+		}
+	}
+
+	return opaque_count;
+}
+
+static void draw_range(Batch_Vertex *unsorted_vertices, Batch_Quad *unsorted_quads, usize quad_count, bool sorted) {
+	usize opaque_count = order_batch(unsorted_vertices, unsorted_quads, quad_count, sorted);
+	Batch_Vertex *vertices = list_sorted_batch->items;
+	Batch_Quad *quads = list_sorted_quads->items;
+
+	glEnable(GL_DEPTH_TEST);
+
+	if(opaque_count > 0) {
+		glDisable(GL_BLEND);
+		glDepthMask(GL_TRUE);
+
+		render_stats_pass_begin(RENDER_PASS_OPAQUE);
+		flush_batch(vertices, quads, opaque_count, RENDER_SHADER_ALPHA_TEST);
+		render_stats_pass_end(RENDER_PASS_OPAQUE);
+	}
+
+	glEnable(GL_BLEND);
+	glDepthMask(GL_FALSE);
+
+	render_stats_pass_begin(RENDER_PASS_TRANSLUCENT);
+	flush_batch(vertices + opaque_count * 4, quads + opaque_count, quad_count - opaque_count, 0);
+	render_stats_pass_end(RENDER_PASS_TRANSLUCENT);
+
+	glDepthMask(GL_TRUE);
+	glDisable(GL_DEPTH_TEST);
+}
+
+static void draw_meshes(Render_Frame *target) {
+	Mesh_Draw *meshes = target->meshes->items;
+	Mesh_Buffers *buffers = list_mesh_buffers->items;
+
+	use_batch_shader(RENDER_SHADER_TEXTURED | RENDER_SHADER_TINTED | RENDER_SHADER_PALETTED);
+	render_state_blend_mode(RENDER_BLEND_ALPHA);
+	render_state_bind_texture(0, texture_color);
+	render_state_bind_texture(RENDER_PALETTE_UNIT, render_palette_texture());
+
+	render_stats_pass_begin(RENDER_PASS_MESHES);
+
+	for(usize i = 0; i < target->meshes->len; ++i) {
+		if(meshes[i].id >= list_mesh_buffers->len) {
+			continue;
+		}
+
+		render_state_bind_texture(1, meshes[i].texture_id);
+		render_state_bind_vertex_array(buffers[meshes[i].id].vao);
+		glDrawElements(GL_TRIANGLES, meshes[i].quad_count * 6, GL_UNSIGNED_SHORT, NULL);
+		render_stats_draw(meshes[i].quad_count);
+	}
+
+	render_stats_pass_end(RENDER_PASS_MESHES);
+}
+
+static void write_screenshot(const char *path) {
+	ui32 width = (ui32)window_width;
+	ui32 height = (ui32)window_height;
+	usize row_size = (usize)width * 4;
+	ui8 *pixels = malloc(row_size * height * 2);
+	if(!pixels) {
+		ERROR_EXIT("Could not allocate %ux%u screenshot\n", width, height);
+	}
+
+	ui8 *flipped = pixels + row_size * height;
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+	for(ui32 y = 0; y < height; ++y) {
+		memcpy(&flipped[y * row_size], &pixels[(height - 1 - y) * row_size], row_size);
+	}
+
+	io_png_write(path, flipped, width, height);
+	free(pixels);
+}
+
+// Nearest-filtered blit of the scene, centred in the window. Any border
+// left by a window size that is not a multiple is cleared.
+static void upscale_scene(void) {
+	ui32 upscale = frame_target.width / scene_target.width;
+	if(frame_target.height / scene_target.height < upscale) {
+		upscale = frame_target.height / scene_target.height;
+	}
+
+	ui32 width = scene_target.width * upscale;
+	ui32 height = scene_target.height * upscale;
+	ui32 x = (frame_target.width - width) / 2;
+	ui32 y = (frame_target.height - height) / 2;
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, scene_target.fbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, frame_target.fbo);
+	glViewport(0, 0, frame_target.width, frame_target.height);
+
+	if(width != frame_target.width || height != frame_target.height) {
+		glClearColor(0, 0, 0, 1);
+		glClear(GL_COLOR_BUFFER_BIT);
+	}
+
+	glBlitFramebuffer(0, 0, scene_target.width, scene_target.height, x, y, x + width, y + height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, frame_target.fbo);
+}
+
+static void frame_end_gl(Render_Frame *target) {
+	draw_meshes(target);
+	if(target->capture != RENDER_CAPTURE_NONE) {
+		render_capture_frame(target, list_mesh_buffers->items, list_mesh_buffers->len);
+	}
+
+	draw_range(target->vertices->items, target->quads->items, target->quads->len, target->is_sorted);
+	render_stats_frame_end();
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, scene_target.fbo);
+	render_video_frame(target->is_video, scene_target.width, scene_target.height);
+	upscale_scene();
+
+	if(target->screenshot_path[0]) {
+		write_screenshot(target->screenshot_path);
+		target->screenshot_path[0] = 0;
+	}
+}
+
+static void frame_end_soft(Render_Frame *target) {
+	render_soft_draw_frame(target, painter_order(target->quads->items, target->quads->len, target->is_sorted));
+	render_stats_frame_end();
+	render_video_pixels(target->is_video, render_soft_pixels(), scene_target.width, scene_target.height);
+
+	if(target->screenshot_path[0]) {
+		io_png_write(target->screenshot_path, render_soft_pixels(), scene_target.width, scene_target.height);
+		target->screenshot_path[0] = 0;
+	}
+}
+
+void render_frame_draw(Render_Frame *target) {
+	if(is_software) {
+		frame_begin_soft(target);
+		render_command_execute(target->commands);
+		frame_end_soft(target);
+		return;
+	}
+
+	frame_begin_gl(target);
+	render_command_execute(target->commands);
+	frame_end_gl(target);
+}
+
+void render_present(SDL_Window *window) {
+	if(is_software) {
+		render_soft_present(window);
+	} else {
+		SDL_GL_SwapWindow(window);
+	}
+}
+
+// Joins the threads the renderer started for itself. Call at exit, after
+// render_thread_stop.
+void render_shutdown(void) {
+	render_texture_shutdown();
+}
+
+// Held while recording, as the video is read from the scene target and
+// frames of another size are dropped.
+static void update_dynamic_resolution(const Render_Stats *stats) {
+	if(!dynamic_resolution.is_enabled || render_video_next()) {
+		return;
+	}
+
+	f32 gpu_ms = 0;
+	for(ui32 pass = 0; pass < RENDER_PASS_COUNT; ++pass) {
+		gpu_ms += stats->gpu_ms[pass];
+	}
+
+	dynamic_resolution.average_ms += (gpu_ms - dynamic_resolution.average_ms) * 0.1f;
+
+	if(dynamic_resolution.cooldown > 0) {
+		--dynamic_resolution.cooldown;
+		return;
+	}
+
+	if(dynamic_resolution.average_ms > dynamic_resolution.budget_ms && dynamic_resolution.level + 1 < DYNAMIC_RESOLUTION_LEVELS) {
+		++dynamic_resolution.level;
+		dynamic_resolution.cooldown = DYNAMIC_RESOLUTION_COOLDOWN;
+	} else if(dynamic_resolution.average_ms < dynamic_resolution.budget_ms * 0.5f && dynamic_resolution.level > 0) {
+		--dynamic_resolution.level;
+		dynamic_resolution.cooldown = DYNAMIC_RESOLUTION_COOLDOWN;
+	}
+}
+
+void render_end(SDL_Window *window) {
+	frame->is_sorted = is_sorted;
+	frame->capture = render_capture_next();
+	frame->is_video = render_video_next();
+
+	if(render_thread_is_running()) {
+		render_thread_submit(frame);
+		frame = frame == &frames[0] ? &frames[1] : &frames[0];
+
+		// The GL side is done with this frame's commands. Clearing them
+		// here rather than in render_begin keeps commands submitted
+		// between frames for the next one.
+		frame->commands->len = 0;
+	} else {
+		// Left from before the render thread stopped.
+		render_command_execute(frame->commands);
+		frame->commands->len = 0;
+
+		if(is_software) {
+			frame_end_soft(frame);
+		} else {
+			frame_end_gl(frame);
+		}
+		render_present(window);
+	}
+
+	render_stats_record(&frame->stats);
+	update_dynamic_resolution(&frame->stats);
+}
+
+// Lowers the scene resolution one level while the smoothed GPU time of
+// finished frames is over budget, and raises it again once there is
+// plenty of headroom. Each change waits for the timers to catch up
+// before the next.
+void render_set_dynamic_resolution(bool is_enabled, f32 budget_ms) {
+	dynamic_resolution = (Dynamic_Resolution){
+		.budget_ms = budget_ms,
+		.average_ms = budget_ms * 0.5f,
+		.is_enabled = is_enabled
+	};
+}
+
+// Saves the current frame as a PNG once it has been drawn.
+void render_screenshot(const char *path) {
+	snprintf(frame->screenshot_path, sizeof(frame->screenshot_path), "%s", path);
+}
+
+// Stats of the most recently finished frame. With the render thread
+// running that is the frame before the one just submitted.
+Render_Stats render_stats(void) {
+	return frame->stats;
+}
+
+static bool static_layer_needs_update(void) {
+	if(!static_layer.is_valid || static_layer.zoom != global.camera.zoom) {
+		return true;
+	}
+
+	return view_rect[0] < static_layer.rect[0] || view_rect[1] < static_layer.rect[1] ||
+		view_rect[2] > static_layer.rect[2] || view_rect[3] > static_layer.rect[3];
+}
+
+// Content submitted between render_static_begin and render_static_end is
+// drawn into a cached texture covering the view plus a margin. Begin
+// returns false while the cache is still good, in which case the caller
+// can skip submitting; render_static_end must be called either way and
+// adds the cached texture to the frame as a single quad.
+bool render_static_begin(void) {
+	if(is_software) {
+		return true;
+	}
+
+	static_layer.is_building = static_layer_needs_update();
+	if(!static_layer.is_building) {
+		return false;
+	}
+
+	static_layer.zoom = global.camera.zoom;
+	static_layer.rect[0] = view_rect[0] - STATIC_LAYER_MARGIN;
+	static_layer.rect[1] = view_rect[1] - STATIC_LAYER_MARGIN;
+	static_layer.rect[2] = view_rect[2] + STATIC_LAYER_MARGIN;
+	static_layer.rect[3] = view_rect[3] + STATIC_LAYER_MARGIN;
+	static_layer.first_quad = frame->quads->len;
+
+	// Cull static content against the cached area instead of the view.
+	memcpy(view_rect, static_layer.rect, sizeof(vec4));
+
+	return true;
+}
+
+// Runs where GL lives: draws the recorded static quads into the layer's
+// framebuffer, resizing it first if the zoom changed its pixel size.
+static void build_static_layer(const void *payload) {
+	const Static_Build *build = payload;
+	Batch_Vertex *vertices = (Batch_Vertex*)(build + 1);
+	Batch_Quad *quads = (Batch_Quad*)(vertices + build->quad_count * 4);
+
+	ui32 width = (ui32)ceilf((build->rect[2] - build->rect[0]) * build->zoom);
+	ui32 height = (ui32)ceilf((build->rect[3] - build->rect[1]) * build->zoom);
+
+	if(width != static_layer.width || height != static_layer.height) {
+		render_init_render_target(&static_layer.fbo, &static_layer.texture, &static_layer.depth, width, height);
+		static_layer.width = width;
+		static_layer.height = height;
+	}
+
+	mat4x4 projection;
+	mat4x4_ortho(projection, build->rect[0], build->rect[2], build->rect[1], build->rect[3], -2, 2);
+	set_projection(projection);
+
+	render_capture_forget_texture(static_layer.texture);
+	render_stats_pass_begin(RENDER_PASS_STATIC);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, static_layer.fbo);
+	glViewport(0, 0, width, height);
+	glClearColor(0, 0, 0, 0);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+	draw_range(vertices, quads, build->quad_count, build->is_sorted);
+	render_stats_pass_end(RENDER_PASS_STATIC);
+
+	bind_scene_target();
+	set_projection(frame_projection);
+}
+
+void render_static_end(void) {
+	if(is_software) {
+		return;
+	}
+
+	if(static_layer.is_building) {
+		usize first = static_layer.first_quad;
+		usize quad_count = frame->quads->len - first;
+		usize vertices_size = quad_count * 4 * sizeof(Batch_Vertex);
+		usize quads_size = quad_count * sizeof(Batch_Quad);
+
+		list_payload->len = 0;
+		Static_Build *build = array_list_append_n(list_payload, sizeof(Static_Build) + vertices_size + quads_size);
+		if(!build) {
+			ERROR_EXIT("Could not allocate static layer build\n");
+		}
+
+		*build = (Static_Build){
+			.rect = {static_layer.rect[0], static_layer.rect[1], static_layer.rect[2], static_layer.rect[3]},
+			.zoom = static_layer.zoom,
+			.quad_count = (ui32)quad_count,
+			.is_sorted = is_sorted
+		};
+
+		ui8 *data = (ui8*)(build + 1);
+		memcpy(data, (Batch_Vertex*)frame->vertices->items + first * 4, vertices_size);
+		memcpy(data + vertices_size, (Batch_Quad*)frame->quads->items + first, quads_size);
+
+		frame->vertices->len = first * 4;
+		frame->quads->len = first;
+
+		render_command_submit(build_static_layer, build, list_payload->len);
+		camera_view_rect(view_rect);
+
+		static_layer.is_valid = true;
+		static_layer.is_building = false;
+	}
+
+	Render_Blend_Mode blend_mode = current_blend_mode;
+	current_blend_mode = RENDER_BLEND_PREMULTIPLIED;
+
+	render_sprites(&(Sprite_Instance){
+		.position = {
+			(static_layer.rect[0] + static_layer.rect[2]) * 0.5,
+			(static_layer.rect[1] + static_layer.rect[3]) * 0.5
+		},
+		.size = {static_layer.rect[2] - static_layer.rect[0], static_layer.rect[3] - static_layer.rect[1]},
+		.uvs = {0, 0, 1, 1},
+		.color = {1, 1, 1, 1},
+		.texture_id = static_layer.texture
+	}, 1);
+
+	current_blend_mode = blend_mode;
+}
+
+void render_static_invalidate(void) {
+	static_layer.is_valid = false;
+}
+
+void render_set_sort_mode(bool sorted) {
+	is_sorted = sorted;
+}
+
+void render_set_layer(ui8 layer) {
+	current_layer = layer;
+}
+
+void render_set_depth(ui16 depth) {
+	current_depth = depth;
+}
+
+void render_set_blend_mode(Render_Blend_Mode blend_mode) {
+	current_blend_mode = blend_mode;
+}
+
+void render_quad(vec2 pos, vec2 size, vec4 color) {
+	render_sprites(&(Sprite_Instance){
+		.position = {pos[0], pos[1]},
+		.size = {size[0], size[1]},
+		.uvs = {0, 0, 1, 1},
+		.color = {color[0], color[1], color[2], color[3]},
+		.is_opaque = color[3] >= 1
+	}, 1);
+}
+
+void render_line_segment(vec2 start, vec2 end, vec4 color) {
 	f32 x = end[0] - start[0];
 	f32 y = end[1] - start[1];
-	f32 line[6] = { 0, 0, 0, x, y, 0 };
+	f32 len = sqrtf(x * x + y * y);
 
-	mat4x4 model;
-	mat4x4_translate(model, start[0], start[1], 0);
+	if(len == 0) {
+		return;
+	}
 
-	glUniformMatrix4fv(glGetUniformLocation(shader_default, "model"), 1, GL_FALSE, &model[0][0]);
-	glUniform4fv(glGetUniformLocation(shader_default, "color"), 1, color);
+	f32 nx = -y / len * line_width * 0.5;
+	f32 ny = x / len * line_width * 0.5;
+	f32 extent_x = fabsf(nx);
+	f32 extent_y = fabsf(ny);
 
-	glBindTexture(GL_TEXTURE_2D, texture_color);
-	glBindVertexArray(vao_line);
+	if(!is_visible(fminf(start[0], end[0]) - extent_x, fminf(start[1], end[1]) - extent_y,
+			fmaxf(start[0], end[0]) + extent_x, fmaxf(start[1], end[1]) + extent_y)) {
+		return;
+	}
 
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_line);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(line), line);
-	glDrawArrays(GL_LINES, 0, 2);
+	vec2 corners[4] = {
+		{start[0] + nx, start[1] + ny},
+		{end[0] + nx, end[1] + ny},
+		{end[0] - nx, end[1] - ny},
+		{start[0] - nx, start[1] - ny}
+	};
 
-	glBindVertexArray(0);
+	append_vertices(corners, (vec4){0, 0, 1, 1}, color, 0);
 }
 
 void render_quad_line(vec2 pos, vec2 size, vec4 color) {
-	vec2 points[4] = {
-		{pos[0] - size[0] * 0.5, pos[1] - size[1] * 0.5},
-		{pos[0] + size[0] * 0.5, pos[1] - size[1] * 0.5},
-		{pos[0] + size[0] * 0.5, pos[1] + size[1] * 0.5},
-		{pos[0] - size[0] * 0.5, pos[1] + size[1] * 0.5}
+	f32 w = size[0];
+	f32 h = size[1];
+	f32 t = line_width;
+
+	if(!is_visible(pos[0] - (w + t) * 0.5, pos[1] - (h + t) * 0.5, pos[0] + (w + t) * 0.5, pos[1] + (h + t) * 0.5)) {
+		return;
+	}
+
+	Sprite_Instance edges[4] = {
+		{.position = {pos[0], pos[1] - h * 0.5}, .size = {w + t, t}},
+		{.position = {pos[0], pos[1] + h * 0.5}, .size = {w + t, t}},
+		{.position = {pos[0] - w * 0.5, pos[1]}, .size = {t, h - t}},
+		{.position = {pos[0] + w * 0.5, pos[1]}, .size = {t, h - t}}
 	};
 
-	render_line_segment(points[0], points[1], color);
-	render_line_segment(points[1], points[2], color);
-	render_line_segment(points[2], points[3], color);
-	render_line_segment(points[3], points[0], color);
+	for(ui32 i = 0; i < 4; ++i) {
+		memcpy(edges[i].uvs, (vec4){0, 0, 1, 1}, sizeof(vec4));
+		memcpy(edges[i].color, color, sizeof(vec4));
+		edges[i].is_opaque = color[3] >= 1;
+	}
+
+	render_sprites(edges, 4);
 }
 
 void render_aabb(f32 *aabb, vec4 color) {
@@ -204,33 +1154,228 @@ void render_aabb(f32 *aabb, vec4 color) {
 	render_quad_line(&aabb[0], size, color);
 }
 
+void render_set_line_width(f32 width) {
+	line_width = width;
+}
+
 f32 render_get_scale() {
 	return scale;
 }
 
+// A cell is opaque when its alpha is only ever 0 or 255, so alpha-test
+// discard in the opaque pass gives the same pixels as blending would.
+// Its bounds enclose every pixel with nonzero alpha.
+void render_sprite_sheet_analyze(Sprite_Sheet *sprite_sheet, const ui8 *image_data) {
+	ui32 width = (ui32)sprite_sheet->width;
+	ui32 cell_width = (ui32)sprite_sheet->cell_width;
+	ui32 cell_height = (ui32)sprite_sheet->cell_height;
+
+	sprite_sheet->column_count = width / cell_width;
+	sprite_sheet->row_count = (ui32)sprite_sheet->height / cell_height;
+	sprite_sheet->cells = calloc(sprite_sheet->column_count * sprite_sheet->row_count, sizeof(Sprite_Cell));
+	if(!sprite_sheet->cells) {
+		ERROR_EXIT("Could not allocate sprite sheet cells\n");
+	}
+
+	for(ui32 row = 0; row < sprite_sheet->row_count; ++row) {
+		for(ui32 column = 0; column < sprite_sheet->column_count; ++column) {
+			Sprite_Cell cell = {.x0 = cell_width, .y0 = cell_height, .is_opaque = true};
+
+			for(ui32 y = 0; y < cell_height; ++y) {
+				const ui8 *pixel = &image_data[((row * cell_height + y) * width + column * cell_width) * 4];
+
+				for(ui32 x = 0; x < cell_width; ++x, pixel += 4) {
+					if(pixel[3] == 0) {
+						continue;
+					}
+
+					if(pixel[3] != 255) {
+						cell.is_opaque = false;
+					}
+
+					cell.x0 = x < cell.x0 ? x : cell.x0;
+					cell.y0 = y < cell.y0 ? y : cell.y0;
+					cell.x1 = x + 1 > cell.x1 ? x + 1 : cell.x1;
+					cell.y1 = y + 1 > cell.y1 ? y + 1 : cell.y1;
+				}
+			}
+
+			if(cell.x1 == 0) {
+				cell.x0 = cell.y0 = 0;
+			}
+
+			sprite_sheet->cells[row * sprite_sheet->column_count + column] = cell;
+		}
+	}
+}
+
 void render_sprite_sheet_init(Sprite_Sheet *sprite_sheet, const char *path, f32 cell_width, f32 cell_height) {
+	if(render_thread_is_running()) {
+		ERROR_EXIT("Sprite sheet %s must be loaded before the render thread starts\n", path);
+	}
+
+	Render_Image image;
+	if(!render_image_load(&image, path)) {
+		ERROR_EXIT("Failed to load image: %s\n", path);
+	}
+
+	if(is_software) {
+		sprite_sheet->texture_id = render_soft_texture_create(image.pixels, image.width, image.height, 4);
+	} else {
+		glGenTextures(1, &sprite_sheet->texture_id);
+		render_state_bind_texture(0, sprite_sheet->texture_id);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels);
+	}
+
+	sprite_sheet->width = (f32)image.width;
+	sprite_sheet->height = (f32)image.height;
+	sprite_sheet->cell_width = cell_width;
+	sprite_sheet->cell_height = cell_height;
+	sprite_sheet->is_premultiplied = image.is_premultiplied;
+
+	render_sprite_sheet_analyze(sprite_sheet, image.pixels);
+	render_image_free(&image);
+}
+
+// Loads a sheet as an indexed texture, one byte per texel, and makes a
+// palette from its colours, at most RENDER_PALETTE_SIZE of them. Sprites
+// from the sheet use that palette unless given another, such as a
+// render_palette_copy with some colours replaced. Sprites with another
+// palette are blended rather than drawn in the opaque pass, but are
+// still trimmed to the pixels the sheet's palette shows. Cooked
+// palettized textures keep their palette and indices as they are.
+void render_sprite_sheet_init_indexed(Sprite_Sheet *sprite_sheet, const char *path, f32 cell_width, f32 cell_height) {
+	if(render_thread_is_running()) {
+		ERROR_EXIT("Sprite sheet %s must be loaded before the render thread starts\n", path);
+	}
+
+	Render_Image image;
+	if(!render_image_load(&image, path)) {
+		ERROR_EXIT("Failed to load image: %s\n", path);
+	}
+
+	usize pixel_count = (usize)image.width * image.height;
+	const ui8 *indices = image.indices;
+	ui8 *palettized = NULL;
+
+	if(indices) {
+		sprite_sheet->palette = render_palette_create_packed(image.palette, image.palette_count);
+	} else {
+		ui32 colors[RENDER_PALETTE_SIZE];
+		ui32 color_count = 0;
+		const ui32 *pixels = (const ui32*)image.pixels;
+
+		palettized = malloc(pixel_count);
+		if(!palettized) {
+			ERROR_EXIT("Could not allocate indices for %s\n", path);
+		}
+
+		for(usize i = 0; i < pixel_count; ++i) {
+			ui32 index = 0;
+			while(index < color_count && colors[index] != pixels[i]) {
+				++index;
+			}
+
+			if(index == color_count) {
+				if(color_count == RENDER_PALETTE_SIZE) {
+					ERROR_EXIT("%s has more than %u colours\n", path, RENDER_PALETTE_SIZE);
+				}
+
+				colors[color_count++] = pixels[i];
+			}
+
+			palettized[i] = (ui8)index;
+		}
+
+		indices = palettized;
+		sprite_sheet->palette = render_palette_create_packed(colors, color_count);
+	}
+
+	if(is_software) {
+		sprite_sheet->texture_id = render_soft_texture_create(indices, image.width, image.height, 1);
+	} else {
+		glGenTextures(1, &sprite_sheet->texture_id);
+		render_state_bind_texture(0, sprite_sheet->texture_id);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, image.width, image.height, 0, GL_RED, GL_UNSIGNED_BYTE, indices);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+
+	sprite_sheet->width = (f32)image.width;
+	sprite_sheet->height = (f32)image.height;
+	sprite_sheet->cell_width = cell_width;
+	sprite_sheet->cell_height = cell_height;
+	sprite_sheet->is_premultiplied = image.is_premultiplied;
+
+	// Opacity follows the sheet's own palette.
+	render_sprite_sheet_analyze(sprite_sheet, image.pixels);
+
+	free(palettized);
+	render_image_free(&image);
+}
+
+// Like render_sprite_sheet_init, but only reads the image's size before
+// returning. The image is decoded on loader threads and uploaded during a
+// later render_begin; until then every cell is empty, so its sprites
+// draw nothing, as they do for good if the image fails to decode. Like
+// all textures, sheets must be created before the render thread starts,
+// though their uploads may finish after. The software backend loads them
+// straight away.
+void render_sprite_sheet_load(Sprite_Sheet *sprite_sheet, const char *path, f32 cell_width, f32 cell_height) {
+	if(is_software) {
+		render_sprite_sheet_init(sprite_sheet, path, cell_width, cell_height);
+		return;
+	}
+
+	if(render_thread_is_running()) {
+		ERROR_EXIT("Sprite sheet %s must be loaded before the render thread starts\n", path);
+	}
+
+	ui32 width, height;
+	if(!render_image_info(path, &width, &height)) {
+		ERROR_EXIT("Failed to load image: %s\n", path);
+	}
+
 	glGenTextures(1, &sprite_sheet->texture_id);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, sprite_sheet->texture_id);
+	render_state_bind_texture(0, sprite_sheet->texture_id);
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-	int width, height, channel_count;
-	ui8 *image_data = stbi_load(path, &width, &height, &channel_count, 0);
-	if(!image_data) {
-		ERROR_EXIT("Failed to load image: %s\n", path);
-	}
-
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image_data);
-	stbi_image_free(image_data);
+	ui8 placeholder[4] = {0};
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
 
 	sprite_sheet->width = (f32)width;
 	sprite_sheet->height = (f32)height;
 	sprite_sheet->cell_width = cell_width;
 	sprite_sheet->cell_height = cell_height;
+	sprite_sheet->column_count = width / (ui32)cell_width;
+	sprite_sheet->row_count = height / (ui32)cell_height;
+	sprite_sheet->cells = calloc(sprite_sheet->column_count * sprite_sheet->row_count, sizeof(Sprite_Cell));
+	if(!sprite_sheet->cells) {
+		ERROR_EXIT("Could not allocate sprite sheet cells\n");
+	}
+
+	render_texture_load(sprite_sheet, path);
+}
+
+// Sprite sheets from render_sprite_sheet_load still waiting for upload.
+ui32 render_sprite_sheet_pending(void) {
+	return render_texture_pending();
 }
 
 static void calculate_sprite_texture_coordinates(vec4 result, f32 row, f32 column, f32 texture_width, f32 texture_height, f32 cell_width, f32 cell_height) {
@@ -245,24 +1390,177 @@ static void calculate_sprite_texture_coordinates(vec4 result, f32 row, f32 colum
 	result[3] = y + h;
 }
 
-void render_sprite_sheet_frame(Sprite_Sheet *sprite_sheet, f32 row, f32 column, vec2 position, bool is_flipped, vec4 color, ui32 texture_slots[8]){
-	vec4 uvs;
-	calculate_sprite_texture_coordinates(uvs, row, column, sprite_sheet->width, sprite_sheet->height, sprite_sheet->cell_width, sprite_sheet->cell_height);
+// Shrinks a full-cell sprite to the cell's bounds. The texels left out
+// are transparent, so the output is the same with fewer fragments.
+static void trim_sprite(Sprite_Instance *sprite, const Sprite_Sheet *sprite_sheet, const Sprite_Cell *cell, f32 row, f32 column, bool is_flipped) {
+	f32 x0 = column * sprite_sheet->cell_width + cell->x0;
+	f32 y0 = row * sprite_sheet->cell_height + cell->y0;
+	f32 x1 = column * sprite_sheet->cell_width + cell->x1;
+	f32 y1 = row * sprite_sheet->cell_height + cell->y1;
+
+	sprite->uvs[0] = x0 / sprite_sheet->width;
+	sprite->uvs[1] = y0 / sprite_sheet->height;
+	sprite->uvs[2] = x1 / sprite_sheet->width;
+	sprite->uvs[3] = y1 / sprite_sheet->height;
+
+	f32 offset_x = (cell->x0 + cell->x1) * 0.5f - sprite_sheet->cell_width * 0.5f;
+	f32 offset_y = (cell->y0 + cell->y1) * 0.5f - sprite_sheet->cell_height * 0.5f;
+
+	sprite->position[0] += is_flipped ? -offset_x : offset_x;
+	sprite->position[1] += offset_y;
+	sprite->size[0] = cell->x1 - cell->x0;
+	sprite->size[1] = cell->y1 - cell->y0;
+}
+
+// Returns false for a cell with nothing to draw, an empty one or one of a
+// sheet still waiting for upload, so no quad is spent on it.
+bool render_sprite_sheet_instance(Sprite_Instance *sprite, const Sprite_Sheet *sprite_sheet, f32 row, f32 column, vec2 position, bool is_flipped, vec4 color) {
+	*sprite = (Sprite_Instance){
+		.position = {position[0], position[1]},
+		.size = {sprite_sheet->cell_width, sprite_sheet->cell_height},
+		.color = {color[0], color[1], color[2], color[3]},
+		.texture_id = sprite_sheet->texture_id,
+		.palette = sprite_sheet->palette,
+		.opaque_palette = sprite_sheet->palette,
+		.is_premultiplied = sprite_sheet->is_premultiplied
+	};
+
+	ui32 cell = (ui32)row * sprite_sheet->column_count + (ui32)column;
+	if(cell < sprite_sheet->row_count * sprite_sheet->column_count) {
+		if(sprite_sheet->cells[cell].x1 == 0) {
+			return false;
+		}
+
+		trim_sprite(sprite, sprite_sheet, &sprite_sheet->cells[cell], row, column, is_flipped);
+		sprite->is_opaque = sprite_sheet->cells[cell].is_opaque && color[3] >= 1;
+	} else {
+		calculate_sprite_texture_coordinates(sprite->uvs, row, column, sprite_sheet->width, sprite_sheet->height, sprite_sheet->cell_width, sprite_sheet->cell_height);
+	}
 
 	if(is_flipped) {
-		f32 tmp = uvs[0];
-		uvs[0] = uvs[2];
-		uvs[2] = tmp;
+		f32 tmp = sprite->uvs[0];
+		sprite->uvs[0] = sprite->uvs[2];
+		sprite->uvs[2] = tmp;
+	}
+
+	return true;
+}
+
+void render_sprite_sheet_frame(Sprite_Sheet *sprite_sheet, f32 row, f32 column, vec2 position, bool is_flipped, vec4 color) {
+	Sprite_Instance sprite;
+	if(render_sprite_sheet_instance(&sprite, sprite_sheet, row, column, position, is_flipped, color)) {
+		render_sprites(&sprite, 1);
+	}
+}
+
+// Meshes hold quads that rarely change, such as tilemap chunks. Their
+// vertices live on the GPU, so drawing one costs a single draw call and
+// no per-frame vertex work. Meshes are drawn before the batch, beneath
+// everything else in the frame. A mesh is only an id on the submitting
+// side; the GL buffers behind it are created and owned where GL lives.
+void render_mesh_buffers_upload(ui32 id, const Batch_Vertex *vertices, ui32 quad_count) {
+	if(is_software) {
+		render_soft_mesh_upload(id, vertices, quad_count);
+		return;
+	}
+
+	while(list_mesh_buffers->len <= id) {
+		array_list_append(list_mesh_buffers, &(Mesh_Buffers){0});
+	}
+
+	Mesh_Buffers *buffers = array_list_get(list_mesh_buffers, id);
+	if(!buffers->vao) {
+		render_init_mesh(&buffers->vao, &buffers->vbo, ebo_batch);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffers->vbo);
+	glBufferData(GL_ARRAY_BUFFER, quad_count * 4 * sizeof(Batch_Vertex), vertices, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	render_stats_upload(quad_count * 4, quad_count * 4 * sizeof(Batch_Vertex));
+
+	buffers->quad_count = quad_count;
+	++buffers->generation;
+}
+
+static void upload_mesh(const void *payload) {
+	const Mesh_Upload *upload = payload;
+	render_mesh_buffers_upload(upload->id, (const Batch_Vertex*)(upload + 1), upload->quad_count);
+}
+
+static void destroy_mesh(const void *payload) {
+	ui32 id = *(const ui32*)payload;
+	if(is_software) {
+		render_soft_mesh_destroy(id);
+		return;
+	}
+
+	if(id >= list_mesh_buffers->len) {
+		return;
+	}
+
+	Mesh_Buffers *buffers = array_list_get(list_mesh_buffers, id);
+	if(buffers->vao) {
+		glDeleteVertexArrays(1, &buffers->vao);
+		glDeleteBuffers(1, &buffers->vbo);
 	}
 
-	vec2 size = {sprite_sheet->cell_width, sprite_sheet->cell_height};
-	vec2 bottom_left = {position[0] - size[0] * 0.5, position[1] - size[1] * 0.5};
+	*buffers = (Mesh_Buffers){0};
+}
+
+void render_mesh_upload(Render_Mesh *mesh, const Sprite_Instance *sprites, usize count) {
+	if(count > MAX_BATCH_QUADS) {
+		ERROR_EXIT("Mesh of %zu quads exceeds %u\n", count, MAX_BATCH_QUADS);
+	}
+
+	if(!mesh->id) {
+		if(list_free_mesh_ids->len > 0) {
+			mesh->id = *(ui32*)array_list_get(list_free_mesh_ids, --list_free_mesh_ids->len);
+		} else {
+			mesh->id = ++mesh_id_count;
+		}
+	}
+
+	list_payload->len = 0;
+	list_mesh_quads->len = 0;
+	Mesh_Upload *upload = array_list_append_n(list_payload, sizeof(Mesh_Upload) + count * 4 * sizeof(Batch_Vertex));
+	Batch_Quad *quads = array_list_append_n(list_mesh_quads, count);
+	if(!upload || !quads) {
+		ERROR_EXIT("Could not allocate mesh vertices\n");
+	}
+
+	Batch_Vertex *vertices = (Batch_Vertex*)(upload + 1);
+	Batch_Quad quad = {0};
+	vec4 everything = {-INFINITY, -INFINITY, INFINITY, INFINITY};
+	usize quad_count = render_batch_emit_sprites(sprites, count, everything, &quad, vertices, quads);
+
+	for(usize i = 0; i < quad_count * 4; ++i) {
+		vertices[i].texture_slot = (vertices[i].texture_slot & ~RENDER_TEXTURE_SLOT_MASK) | 1;
+		vertices[i].order = 0;
+	}
+
+	*upload = (Mesh_Upload){.id = mesh->id, .quad_count = (ui32)quad_count};
+	render_command_submit(upload_mesh, upload, sizeof(Mesh_Upload) + quad_count * 4 * sizeof(Batch_Vertex));
+
+	mesh->quad_count = (ui32)quad_count;
+}
+
+void render_mesh(const Render_Mesh *mesh, ui32 texture_id) {
+	if(mesh->quad_count == 0) {
+		return;
+	}
+
+	array_list_append(frame->meshes, &(Mesh_Draw){
+		.id = mesh->id,
+		.quad_count = mesh->quad_count,
+		.texture_id = texture_id
+	});
+}
 
-	i32 texture_slot = try_insert_texture(texture_slots, sprite_sheet->texture_id);
-	if(texture_slot == -1) {
-		// Flush or something?
+void render_mesh_destroy(Render_Mesh *mesh) {
+	if(mesh->id) {
+		render_command_submit(destroy_mesh, &mesh->id, sizeof(mesh->id));
+		array_list_append(list_free_mesh_ids, &mesh->id);
 	}
 
-	printf("texture_slot: %d\n", texture_slot);
-	append_quad(bottom_left, size, uvs, color, (f32)texture_slot);
+	*mesh = (Render_Mesh){0};
 }
\ No newline at end of file
@@ -0,0 +1,210 @@
+#include <assert.h>
+#include <string.h>
+
+#include "render_internal.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define RENDER_BATCH_SSE
+#include <xmmintrin.h>
+#endif
+
+// UVs are packed to unorm16 and must lie in [0, 1], so a texture cannot
+// repeat across one quad; tile it with a quad per repeat instead. The
+// slack allows for rounding in UVs worked out from pixel positions.
+ui16 render_pack_unorm16(f32 value) {
+	assert(value >= -0.001f && value <= 1.001f);
+
+	if(value <= 0) {
+		return 0;
+	}
+	if(value >= 1) {
+		return 0xFFFF;
+	}
+
+	return (ui16)(value * 65535.f + 0.5f);
+}
+
+ui8 render_pack_unorm8(f32 value) {
+	if(value <= 0) {
+		return 0;
+	}
+	if(value >= 1) {
+		return 0xFF;
+	}
+
+	return (ui8)(value * 255.f + 0.5f);
+}
+
+static ui32 pack_uv(ui16 u, ui16 v) {
+	return (ui32)u | ((ui32)v << 16);
+}
+
+ui32 render_pack_color(const f32 color[4]) {
+	ui8 packed[4] = {
+		render_pack_unorm8(color[0]),
+		render_pack_unorm8(color[1]),
+		render_pack_unorm8(color[2]),
+		render_pack_unorm8(color[3])
+	};
+
+	ui32 result;
+	memcpy(&result, packed, sizeof(result));
+
+	return result;
+}
+
+// Writes the UV, colour and palette words of the four corners; positions are done by the caller.
+static void emit_attributes(const Sprite_Instance *sprite, Batch_Vertex *v) {
+	ui16 u0 = render_pack_unorm16(sprite->uvs[0]);
+	ui16 v0 = render_pack_unorm16(sprite->uvs[1]);
+	ui16 u1 = render_pack_unorm16(sprite->uvs[2]);
+	ui16 v1 = render_pack_unorm16(sprite->uvs[3]);
+	ui32 uvs[4] = {pack_uv(u0, v0), pack_uv(u1, v0), pack_uv(u1, v1), pack_uv(u0, v1)};
+	ui32 color;
+	if(sprite->is_premultiplied) {
+		f32 a = sprite->color[3];
+		color = render_pack_color((f32[4]){sprite->color[0] * a, sprite->color[1] * a, sprite->color[2] * a, a});
+	} else {
+		color = render_pack_color(sprite->color);
+	}
+
+	for(ui32 i = 0; i < 4; ++i) {
+		memcpy(v[i].uvs, &uvs[i], sizeof(ui32));
+		memcpy(v[i].color, &color, sizeof(ui32));
+		v[i].texture_slot = (ui16)(sprite->palette << RENDER_PALETTE_SHIFT);
+	}
+}
+
+static void emit_quad(const Sprite_Instance *sprite, const Batch_Quad *quad, Batch_Quad *out) {
+	*out = *quad;
+	out->texture_id = sprite->texture_id;
+	out->is_opaque = quad->is_opaque && sprite->is_opaque && sprite->palette == sprite->opaque_palette;
+
+	// Opaque quads come out the same either way, so they keep batching
+	// with the rest of the opaque pass.
+	if(sprite->is_premultiplied && !out->is_opaque && quad->blend_mode == RENDER_BLEND_ALPHA) {
+		out->blend_mode = RENDER_BLEND_PREMULTIPLIED;
+	}
+}
+
+#ifdef RENDER_BATCH_SSE
+
+usize render_batch_emit_sprites(const Sprite_Instance *sprites, usize count, const vec4 view_rect, const Batch_Quad *quad, Batch_Vertex *vertices, Batch_Quad *quads) {
+	const __m128 half = _mm_set_ps(0.5f, 0.5f, -0.5f, -0.5f);
+	const __m128 view = _mm_loadu_ps(view_rect);
+	usize emitted = 0;
+
+	for(usize i = 0; i < count; ++i) {
+		const Sprite_Instance *sprite = &sprites[i];
+		Batch_Vertex *v = &vertices[emitted * 4];
+
+		__m128 center = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)sprite->position);
+		__m128 size = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)sprite->size);
+		center = _mm_movelh_ps(center, center);
+		size = _mm_movelh_ps(size, size);
+
+		// rect = {x0, y0, x1, y1}, crossed = {x1, y1, x0, y0}, mixed = {x1, y0, x0, y1}
+		__m128 rect = _mm_add_ps(center, _mm_mul_ps(size, half));
+		__m128 crossed = _mm_shuffle_ps(rect, rect, _MM_SHUFFLE(1, 0, 3, 2));
+		__m128 mixed = _mm_shuffle_ps(rect, rect, _MM_SHUFFLE(3, 0, 1, 2));
+
+		// Visible when {x1, y1} >= view min and {x0, y0} <= view max.
+		i32 past_min = _mm_movemask_ps(_mm_cmpge_ps(crossed, view)) & 0x3;
+		i32 before_max = _mm_movemask_ps(_mm_cmple_ps(crossed, view)) & 0xC;
+		if((past_min | before_max) != 0xF) {
+			continue;
+		}
+
+		_mm_storel_pi((__m64*)v[0].position, rect);
+		_mm_storel_pi((__m64*)v[1].position, mixed);
+		_mm_storeh_pi((__m64*)v[2].position, rect);
+		_mm_storeh_pi((__m64*)v[3].position, mixed);
+
+		emit_attributes(sprite, v);
+		emit_quad(sprite, quad, &quads[emitted++]);
+	}
+
+	return emitted;
+}
+
+#else
+
+usize render_batch_emit_sprites(const Sprite_Instance *sprites, usize count, const vec4 view_rect, const Batch_Quad *quad, Batch_Vertex *vertices, Batch_Quad *quads) {
+	usize emitted = 0;
+
+	for(usize i = 0; i < count; ++i) {
+		const Sprite_Instance *sprite = &sprites[i];
+		Batch_Vertex *v = &vertices[emitted * 4];
+
+		f32 x0 = sprite->position[0] - sprite->size[0] * 0.5f;
+		f32 y0 = sprite->position[1] - sprite->size[1] * 0.5f;
+		f32 x1 = sprite->position[0] + sprite->size[0] * 0.5f;
+		f32 y1 = sprite->position[1] + sprite->size[1] * 0.5f;
+
+		if(x1 < view_rect[0] || y1 < view_rect[1] || x0 > view_rect[2] || y0 > view_rect[3]) {
+			continue;
+		}
+
+		v[0].position[0] = x0; v[0].position[1] = y0;
+		v[1].position[0] = x1; v[1].position[1] = y0;
+		v[2].position[0] = x1; v[2].position[1] = y1;
+		v[3].position[0] = x0; v[3].position[1] = y1;
+
+		emit_attributes(sprite, v);
+		emit_quad(sprite, quad, &quads[emitted++]);
+	}
+
+	return emitted;
+}
+
+#endif
+
+// LSD radix sort on 8-bit digits. Stable, so equal keys keep submission order.
+// Returns whichever of indices/tmp_indices holds the sorted order.
+ui32 *render_batch_radix_sort(ui64 *keys, ui32 *indices, ui64 *tmp_keys, ui32 *tmp_indices, usize count) {
+	if(count == 0) {
+		return indices;
+	}
+
+	usize histogram[8][256] = {0};
+
+	for(usize i = 0; i < count; ++i) {
+		ui64 key = keys[i];
+		for(ui32 pass = 0; pass < 8; ++pass) {
+			++histogram[pass][(key >> (pass * 8)) & 0xFF];
+		}
+	}
+
+	for(ui32 pass = 0; pass < 8; ++pass) {
+		usize *counts = histogram[pass];
+		ui32 shift = pass * 8;
+
+		// Every key shares this digit, the pass would not move anything.
+		if(counts[(keys[0] >> shift) & 0xFF] == count) {
+			continue;
+		}
+
+		usize offset = 0;
+		for(ui32 digit = 0; digit < 256; ++digit) {
+			usize digit_count = counts[digit];
+			counts[digit] = offset;
+			offset += digit_count;
+		}
+
+		for(usize i = 0; i < count; ++i) {
+			usize destination = counts[(keys[i] >> shift) & 0xFF]++;
+			tmp_keys[destination] = keys[i];
+			tmp_indices[destination] = indices[i];
+		}
+
+		ui64 *swap_keys = keys;
+		keys = tmp_keys;
+		tmp_keys = swap_keys;
+
+		ui32 *swap_indices = indices;
+		indices = tmp_indices;
+		tmp_indices = swap_indices;
+	}
+
+	return indices;
+}
\ No newline at end of file
@@ -0,0 +1,261 @@
+#include <glad/glad.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../util.h"
+#include "../render.h"
+#include "../array_list.h"
+#include "render_internal.h"
+
+typedef struct captured_mesh {
+	ui32 id;
+	ui32 generation;
+} Captured_Mesh;
+
+typedef struct render_capture {
+	char path[256];
+	ui32 frames_left;
+	FILE *file;
+	Array_List *textures;
+	Array_List *meshes;
+	ui32 palette_generation;
+} Render_Capture;
+
+static Render_Capture capture;
+
+// Captures the next frame_count frames into path. The frames are written
+// where GL lives, right before they are drawn, so the file holds exactly
+// what reached the GPU.
+void render_capture_begin(const char *path, ui32 frame_count) {
+	snprintf(capture.path, sizeof(capture.path), "%s", path);
+	capture.frames_left = frame_count;
+}
+
+ui8 render_capture_next(void) {
+	if(capture.frames_left == 0) {
+		return RENDER_CAPTURE_NONE;
+	}
+
+	return --capture.frames_left == 0 ? RENDER_CAPTURE_LAST : RENDER_CAPTURE_FRAME;
+}
+
+static void write_chunk(ui32 type, const void *header, usize header_size, const void *data, usize data_size) {
+	Render_Capture_Chunk chunk = {.type = type, .size = (ui32)(header_size + data_size)};
+
+	fwrite(&chunk, sizeof(chunk), 1, capture.file);
+	fwrite(header, header_size, 1, capture.file);
+	if(data_size > 0) {
+		fwrite(data, data_size, 1, capture.file);
+	}
+}
+
+// glGetTexImage ignores the texture's swizzle, so it is applied here and
+// the capture holds the RGBA the shader samples. The glyph atlas, single
+// channel coverage read as white with that alpha, replays as plain RGBA.
+static void apply_swizzle(ui8 *pixels, usize pixel_count) {
+	const i32 names[4] = {GL_TEXTURE_SWIZZLE_R, GL_TEXTURE_SWIZZLE_G, GL_TEXTURE_SWIZZLE_B, GL_TEXTURE_SWIZZLE_A};
+	i32 swizzle[4];
+	bool is_identity = true;
+
+	for(ui32 i = 0; i < 4; ++i) {
+		glGetTexParameteriv(GL_TEXTURE_2D, names[i], &swizzle[i]);
+		is_identity = is_identity && swizzle[i] == GL_RED + (i32)i;
+	}
+
+	if(is_identity) {
+		return;
+	}
+
+	for(usize i = 0; i < pixel_count; ++i) {
+		ui8 *pixel = &pixels[i * 4];
+		ui8 source[4] = {pixel[0], pixel[1], pixel[2], pixel[3]};
+
+		for(ui32 channel = 0; channel < 4; ++channel) {
+			switch(swizzle[channel]) {
+				case GL_ZERO: pixel[channel] = 0; break;
+				case GL_ONE: pixel[channel] = 255; break;
+				default: pixel[channel] = source[swizzle[channel] - GL_RED]; break;
+			}
+		}
+	}
+}
+
+static void capture_texture(ui32 texture_id) {
+	ui32 *ids = capture.textures->items;
+	for(usize i = 0; i < capture.textures->len; ++i) {
+		if(ids[i] == texture_id) {
+			return;
+		}
+	}
+
+	i32 width, height;
+	render_state_bind_texture(0, texture_id);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+
+	usize size = (usize)width * height * 4;
+	ui8 *pixels = malloc(size);
+	if(!pixels) {
+		ERROR_EXIT("Could not allocate %dx%d capture texture\n", width, height);
+	}
+
+	glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	apply_swizzle(pixels, (usize)width * height);
+
+	Render_Capture_Texture header = {.texture_id = texture_id, .width = width, .height = height};
+	write_chunk(RENDER_CAPTURE_CHUNK_TEXTURE, &header, sizeof(header), pixels, size);
+	free(pixels);
+
+	array_list_append(capture.textures, &texture_id);
+}
+
+static void capture_mesh(const Mesh_Buffers *buffers, ui32 id) {
+	Captured_Mesh *meshes = capture.meshes->items;
+	Captured_Mesh *captured = NULL;
+
+	for(usize i = 0; i < capture.meshes->len; ++i) {
+		if(meshes[i].id == id) {
+			captured = &meshes[i];
+			break;
+		}
+	}
+
+	if(captured && captured->generation == buffers->generation) {
+		return;
+	}
+
+	usize size = buffers->quad_count * 4 * sizeof(Batch_Vertex);
+	Batch_Vertex *vertices = malloc(size);
+	if(!vertices) {
+		ERROR_EXIT("Could not allocate capture mesh of %u quads\n", buffers->quad_count);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffers->vbo);
+	glGetBufferSubData(GL_ARRAY_BUFFER, 0, size, vertices);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	Render_Capture_Mesh header = {.id = id, .quad_count = buffers->quad_count};
+	write_chunk(RENDER_CAPTURE_CHUNK_MESH, &header, sizeof(header), vertices, size);
+	free(vertices);
+
+	if(captured) {
+		captured->generation = buffers->generation;
+	} else {
+		array_list_append(capture.meshes, &(Captured_Mesh){.id = id, .generation = buffers->generation});
+	}
+}
+
+static void capture_palettes(void) {
+	ui32 generation = render_palette_generation();
+	if(generation == capture.palette_generation) {
+		return;
+	}
+
+	usize size = (usize)RENDER_PALETTE_SIZE * MAX_RENDER_PALETTES * 4;
+	ui8 *rows = malloc(size);
+	if(!rows) {
+		ERROR_EXIT("Could not allocate capture palettes\n");
+	}
+
+	render_state_bind_texture(0, render_palette_texture());
+	glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, rows);
+
+	write_chunk(RENDER_CAPTURE_CHUNK_PALETTES, rows, size, NULL, 0);
+	free(rows);
+
+	capture.palette_generation = generation;
+}
+
+static void open_capture(void) {
+	capture.file = fopen(capture.path, "wb");
+	if(!capture.file) {
+		ERROR_EXIT("Cannot write capture file: %s\n", capture.path);
+	}
+
+	if(!capture.textures) {
+		capture.textures = array_list_create(sizeof(ui32), 0);
+		capture.meshes = array_list_create(sizeof(Captured_Mesh), 0);
+	}
+
+	capture.textures->len = 0;
+	capture.meshes->len = 0;
+	capture.palette_generation = 0;
+
+	Render_Capture_Header header = {
+		.magic = RENDER_CAPTURE_MAGIC,
+		.version = RENDER_CAPTURE_VERSION,
+		.vertex_size = sizeof(Batch_Vertex),
+		.quad_size = sizeof(Batch_Quad)
+	};
+
+	fwrite(&header, sizeof(header), 1, capture.file);
+}
+
+void render_capture_frame(Render_Frame *frame, const Mesh_Buffers *buffers, usize buffer_count) {
+	if(!capture.file) {
+		open_capture();
+	}
+
+	Batch_Quad *quads = frame->quads->items;
+	Mesh_Draw *meshes = frame->meshes->items;
+	ui32 last_texture_id = 0;
+
+	capture_palettes();
+
+	for(usize i = 0; i < frame->quads->len; ++i) {
+		if(quads[i].texture_id != 0 && quads[i].texture_id != last_texture_id) {
+			capture_texture(quads[i].texture_id);
+			last_texture_id = quads[i].texture_id;
+		}
+	}
+
+	for(usize i = 0; i < frame->meshes->len; ++i) {
+		capture_texture(meshes[i].texture_id);
+		if(meshes[i].id < buffer_count) {
+			capture_mesh(&buffers[meshes[i].id], meshes[i].id);
+		}
+	}
+
+	Render_Capture_Frame header = {
+		.is_sorted = frame->is_sorted,
+		.quad_count = (ui32)frame->quads->len,
+		.mesh_count = (ui32)frame->meshes->len
+	};
+	mat4x4_dup(header.projection, frame->projection);
+
+	usize vertices_size = frame->vertices->len * sizeof(Batch_Vertex);
+	usize quads_size = frame->quads->len * sizeof(Batch_Quad);
+	usize meshes_size = frame->meshes->len * sizeof(Mesh_Draw);
+	Render_Capture_Chunk chunk = {
+		.type = RENDER_CAPTURE_CHUNK_FRAME,
+		.size = (ui32)(sizeof(header) + vertices_size + quads_size + meshes_size)
+	};
+
+	fwrite(&chunk, sizeof(chunk), 1, capture.file);
+	fwrite(&header, sizeof(header), 1, capture.file);
+	fwrite(frame->vertices->items, 1, vertices_size, capture.file);
+	fwrite(frame->quads->items, 1, quads_size, capture.file);
+	fwrite(frame->meshes->items, 1, meshes_size, capture.file);
+
+	if(frame->capture == RENDER_CAPTURE_LAST) {
+		fclose(capture.file);
+		capture.file = NULL;
+		printf("Render capture written to %s\n", capture.path);
+	}
+}
+
+// Called when a texture's contents change so the next frame using it
+// writes it again.
+void render_capture_forget_texture(ui32 texture_id) {
+	if(!capture.file) {
+		return;
+	}
+
+	ui32 *ids = capture.textures->items;
+	for(usize i = 0; i < capture.textures->len; ++i) {
+		if(ids[i] == texture_id) {
+			ids[i] = ids[--capture.textures->len];
+			return;
+		}
+	}
+}
\ No newline at end of file
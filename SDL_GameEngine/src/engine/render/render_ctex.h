@@ -0,0 +1,27 @@
+#pragma once
+
+#include "../types.h"
+
+// Cooked textures, written by tools/cook.c. A header, then either
+// width * height RGBA8 pixels or, when palettized, palette_count RGBA8
+// entries followed by width * height ui8 indices. Rows are bottom-up, as
+// stb_image returns them with flipping on and as GL expects. The source
+// image's size and modification time are kept to tell when it has changed.
+#define RENDER_CTEX_MAGIC 0x58455443
+#define RENDER_CTEX_VERSION 2
+
+typedef enum render_ctex_flags {
+	RENDER_CTEX_PREMULTIPLIED = 1 << 0,
+	RENDER_CTEX_PALETTIZED = 1 << 1
+} Render_Ctex_Flags;
+
+typedef struct render_ctex_header {
+	ui32 magic;
+	ui32 version;
+	ui32 width;
+	ui32 height;
+	ui32 flags;
+	ui32 palette_count;
+	ui64 source_size;
+	i64 source_mtime;
+} Render_Ctex_Header;
\ No newline at end of file
@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <string.h>
+#include <stb_image.h>
+
+#include "../util.h"
+#include "../io.h"
+#include "render_internal.h"
+#include "render_ctex.h"
+
+// A cooked texture next to an image, "assets/player.png" giving
+// "assets/player.ctex", is used in its place while the image has the size
+// and modification time it was cooked from. A stale one is passed over for
+// the image. Without the image, as in a shipped build, it is used as is.
+static bool cooked_path(char *result, usize size, const char *path) {
+	const char *extension = strrchr(path, '.');
+	usize stem = extension ? (usize)(extension - path) : strlen(path);
+
+	if(snprintf(result, size, "%.*s.ctex", (int)stem, path) >= (int)size) {
+		return false;
+	}
+
+	FILE *fp = fopen(result, "rb");
+	if(!fp) {
+		return false;
+	}
+
+	Render_Ctex_Header header;
+	bool is_read = fread(&header, sizeof(header), 1, fp) == 1;
+	fclose(fp);
+
+	ui64 source_size;
+	i64 source_mtime;
+	if(!io_file_stat(path, &source_size, &source_mtime)) {
+		return true;
+	}
+
+	if(!is_read || header.magic != RENDER_CTEX_MAGIC || header.version != RENDER_CTEX_VERSION || header.source_size != source_size || header.source_mtime != source_mtime) {
+		printf("%s is out of date, loading %s\n", result, path);
+		return false;
+	}
+
+	return true;
+}
+
+static const Render_Ctex_Header *ctex_header(const Mapped_File *mapping, const char *path) {
+	const Render_Ctex_Header *header = (const Render_Ctex_Header*)mapping->data;
+	if(mapping->len < sizeof(*header) || header->magic != RENDER_CTEX_MAGIC || header->version != RENDER_CTEX_VERSION) {
+		ERROR_RETURN(NULL, "Not a cooked texture: %s\n", path);
+	}
+
+	usize pixel_count = (usize)header->width * header->height;
+	usize expected = header->flags & RENDER_CTEX_PALETTIZED ?
+		sizeof(*header) + header->palette_count * 4 + pixel_count :
+		sizeof(*header) + pixel_count * 4;
+
+	if(mapping->len < expected || header->palette_count > 256) {
+		ERROR_RETURN(NULL, "Cooked texture is truncated: %s\n", path);
+	}
+
+	return header;
+}
+
+bool render_image_info(const char *path, ui32 *width, ui32 *height) {
+	char cooked[256];
+	if(cooked_path(cooked, sizeof(cooked), path)) {
+		Mapped_File mapping = io_file_map(cooked);
+		const Render_Ctex_Header *header = mapping.is_valid ? ctex_header(&mapping, cooked) : NULL;
+		if(header) {
+			*width = header->width;
+			*height = header->height;
+		}
+
+		io_file_unmap(&mapping);
+		return header != NULL;
+	}
+
+	int w, h, channel_count;
+	if(!stbi_info(path, &w, &h, &channel_count)) {
+		return false;
+	}
+
+	*width = (ui32)w;
+	*height = (ui32)h;
+	return true;
+}
+
+// Loads an image as RGBA8 whatever its channel count. Raw cooked pixels
+// are used straight from the mapping; only palettized ones are expanded.
+bool render_image_load(Render_Image *image, const char *path) {
+	*image = (Render_Image){0};
+
+	char cooked[256];
+	if(!cooked_path(cooked, sizeof(cooked), path)) {
+		int width, height, channel_count;
+		image->decoded = stbi_load(path, &width, &height, &channel_count, 4);
+		image->pixels = image->decoded;
+		image->width = (ui32)width;
+		image->height = (ui32)height;
+
+		return image->decoded != NULL;
+	}
+
+	image->mapping = io_file_map(cooked);
+	const Render_Ctex_Header *header = image->mapping.is_valid ? ctex_header(&image->mapping, cooked) : NULL;
+	if(!header) {
+		render_image_free(image);
+		return false;
+	}
+
+	const ui8 *data = (const ui8*)(header + 1);
+	usize pixel_count = (usize)header->width * header->height;
+
+	image->width = header->width;
+	image->height = header->height;
+	image->is_premultiplied = header->flags & RENDER_CTEX_PREMULTIPLIED;
+	image->pixels = data;
+
+	if(header->flags & RENDER_CTEX_PALETTIZED) {
+		const ui32 *palette = (const ui32*)data;
+		const ui8 *indices = data + header->palette_count * 4;
+
+		image->palette = palette;
+		image->palette_count = header->palette_count;
+		image->indices = indices;
+
+		image->expanded = malloc(pixel_count * 4);
+		if(!image->expanded) {
+			render_image_free(image);
+			ERROR_RETURN(false, "Could not expand cooked texture: %s\n", cooked);
+		}
+
+		ui32 *pixels = (ui32*)image->expanded;
+		for(usize i = 0; i < pixel_count; ++i) {
+			pixels[i] = indices[i] < header->palette_count ? palette[indices[i]] : 0;
+		}
+
+		image->pixels = image->expanded;
+	}
+
+	return true;
+}
+
+void render_image_free(Render_Image *image) {
+	if(image->decoded) {
+		stbi_image_free(image->decoded);
+	}
+
+	free(image->expanded);
+	io_file_unmap(&image->mapping);
+
+	*image = (Render_Image){0};
+}
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include <glad/glad.h>
 #include <SDL2/SDL.h>
+#include <string.h>
 
 #include "../util.h"
 #include "../global.h"
@@ -7,10 +8,15 @@
 #include "../render.h"
 #include "render_internal.h"
 
-SDL_Window *render_init_window(ui32 width, ui32 height) {
+SDL_Window *render_init_window(ui32 width, ui32 height, bool is_headless) {
+	if(is_headless) {
+		SDL_SetHint(SDL_HINT_VIDEODRIVER, "offscreen");
+	}
+
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
 
 	if(SDL_Init(SDL_INIT_VIDEO) < 0) {
 		ERROR_EXIT("Could not init SDL: %s\n", SDL_GetError());
@@ -22,7 +28,7 @@ SDL_Window *render_init_window(ui32 width, ui32 height) {
 		SDL_WINDOWPOS_CENTERED,
 		width,
 		height,
-		SDL_WINDOW_OPENGL
+		SDL_WINDOW_OPENGL | (is_headless ? SDL_WINDOW_HIDDEN : 0)
 	);
 
 	if(!window) {
@@ -37,37 +43,102 @@ SDL_Window *render_init_window(ui32 width, ui32 height) {
 	return window;
 }
 
-void render_init_shaders(ui32 *shader_default, ui32 *shader_batch, f32 render_width, f32 render_height) {
-	mat4x4 projection;
-	*shader_default = render_shader_create("./shaders/default.vert", "./shaders/default.frag");
-	*shader_batch = render_shader_create("./shaders/batch_quad.vert", "./shaders/batch_quad.frag");
+// A plain window for the software backend, presented through its surface.
+// Without a display the offscreen driver provides the window and nothing
+// is shown.
+SDL_Window *render_init_window_software(ui32 width, ui32 height, bool is_headless) {
+	if(is_headless) {
+		SDL_SetHint(SDL_HINT_VIDEODRIVER, "offscreen");
+	}
 
-	mat4x4_ortho(projection, 0, render_width, 0, render_height, -2, 2);
+	if(SDL_Init(SDL_INIT_VIDEO) < 0) {
+		ERROR_EXIT("Could not init SDL: %s\n", SDL_GetError());
+	}
 
-	glUseProgram(*shader_default);
-	glUniformMatrix4fv(
-		glGetUniformLocation(*shader_default, "projection"),
-		1, GL_FALSE, &projection[0][0]
+	SDL_Window *window = SDL_CreateWindow(
+		"MyGame",
+		SDL_WINDOWPOS_CENTERED,
+		SDL_WINDOWPOS_CENTERED,
+		width,
+		height,
+		is_headless ? SDL_WINDOW_HIDDEN : 0
 	);
 
-	glUseProgram(*shader_batch);
-	glUniformMatrix4fv(
-		glGetUniformLocation(*shader_batch, "projection"),
-		1, GL_FALSE, &projection[0][0]
-	);
+	if(!window) {
+		ERROR_EXIT("Failed to init window: %s\n", SDL_GetError());
+	}
+
+	return window;
+}
+
+// Untextured batches always draw with TINTED alone; every textured
+// combination can come out of a batch.
+static bool is_variant_reachable(ui32 features) {
+	return features == RENDER_SHADER_TINTED || (features & RENDER_SHADER_TEXTURED);
+}
+
+// Only reachable variants are compiled; the rest stay 0.
+void render_init_shaders(ui32 *shader_default, ui32 shader_batch[RENDER_SHADER_VARIANT_COUNT]) {
+	*shader_default = render_shader_create("./shaders/default.vert", "./shaders/default.frag");
 
-	for(ui32 i = 0; i < 8; ++i) {
-		char name[] = "texture_slot_N";
-		sprintf(name, "texture_slot_%u", i);
-		glUniform1i(glGetUniformLocation(*shader_batch, name), i);
+	for(ui32 features = 0; features < RENDER_SHADER_VARIANT_COUNT; ++features) {
+		if(!is_variant_reachable(features)) {
+			shader_batch[features] = 0;
+			continue;
+		}
+
+		char defines[128] = "";
+		if(features & RENDER_SHADER_TEXTURED) {
+			strcat(defines, "#define TEXTURED\n");
+		}
+		if(features & RENDER_SHADER_TINTED) {
+			strcat(defines, "#define TINTED\n");
+		}
+		if(features & RENDER_SHADER_ALPHA_TEST) {
+			strcat(defines, "#define ALPHA_TEST\n");
+		}
+		if(features & RENDER_SHADER_PALETTED) {
+			strcat(defines, "#define PALETTED\n");
+		}
+
+		shader_batch[features] = render_shader_create_variant("./shaders/batch_quad.vert", "./shaders/batch_quad.frag", defines);
+
+		if(features & RENDER_SHADER_TEXTURED) {
+			render_state_use_program(shader_batch[features]);
+
+			for(ui32 i = 0; i < 8; ++i) {
+				char name[] = "texture_slot_N";
+				sprintf(name, "texture_slot_%u", i);
+				glUniform1i(render_state_uniform_location(shader_batch[features], name), i);
+			}
+
+			glUniform1i(render_state_uniform_location(shader_batch[features], "palette_texture"), RENDER_PALETTE_UNIT);
+		}
 	}
 }
 
+static void set_batch_vertex_attributes(void) {
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Batch_Vertex), (void*)offsetof(Batch_Vertex, position));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(Batch_Vertex), (void*)offsetof(Batch_Vertex, uvs));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Batch_Vertex), (void*)offsetof(Batch_Vertex, color));
+	glEnableVertexAttribArray(3);
+	glVertexAttribIPointer(3, 1, GL_UNSIGNED_SHORT, sizeof(Batch_Vertex), (void*)offsetof(Batch_Vertex, texture_slot));
+	glEnableVertexAttribArray(4);
+	glVertexAttribIPointer(4, 1, GL_UNSIGNED_SHORT, sizeof(Batch_Vertex), (void*)offsetof(Batch_Vertex, order));
+}
+
 void render_init_batch_quads(ui32 *vao, ui32 *vbo, ui32 *ebo) {
 	glGenVertexArrays(1, vao);
-	glBindVertexArray(*vao);
+	render_state_bind_vertex_array(*vao);
+
+	ui16 *indices = malloc(MAX_BATCH_ELEMENTS * sizeof(ui16));
+	if(!indices) {
+		ERROR_EXIT("Could not allocate batch indices\n");
+	}
 
-	ui32 indices[MAX_BATCH_ELEMENTS];
 	for(ui32 i = 0, offset = 0; i < MAX_BATCH_ELEMENTS; i += 6, offset += 4) {
 		indices[i + 0] = offset + 0;
 		indices[i + 1] = offset + 1;
@@ -81,32 +152,39 @@ void render_init_batch_quads(ui32 *vao, ui32 *vbo, ui32 *ebo) {
 	glBindBuffer(GL_ARRAY_BUFFER, *vbo);
 	glBufferData(GL_ARRAY_BUFFER, MAX_BATCH_VERTICES * sizeof(Batch_Vertex), NULL, GL_DYNAMIC_DRAW);
 
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Batch_Vertex), (void*)offsetof(Batch_Vertex, position));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Batch_Vertex), (void*)offsetof(Batch_Vertex, uvs));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 4, GL_FLOAT,GL_FALSE, sizeof(Batch_Vertex), (void*)offsetof(Batch_Vertex, color));
-	glEnableVertexAttribArray(3);
-	glVertexAttribPointer(3, 1, GL_FLOAT,GL_FALSE, sizeof(Batch_Vertex), (void*)offsetof(Batch_Vertex, texture_slot));
+	set_batch_vertex_attributes();
 
 	glGenBuffers(1, ebo);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, MAX_BATCH_ELEMENTS * sizeof(ui32), indices, GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, MAX_BATCH_ELEMENTS * sizeof(ui16), indices, GL_STATIC_DRAW);
+	free(indices);
 
-	glBindVertexArray(0);
+	render_state_bind_vertex_array(0);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
+void render_init_mesh(ui32 *vao, ui32 *vbo, ui32 ebo) {
+	glGenVertexArrays(1, vao);
+	render_state_bind_vertex_array(*vao);
+
+	glGenBuffers(1, vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, *vbo);
+	set_batch_vertex_attributes();
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+
+	render_state_bind_vertex_array(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
 void render_init_color_texture(ui32 *texture) {
 	glGenTextures(1, texture);
-	glBindTexture(GL_TEXTURE_2D, *texture);
+	render_state_bind_texture(0, *texture);
 
 	ui8 solid_white[4] = {255, 255, 255, 255};
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, solid_white);
 
-	glBindTexture(GL_TEXTURE_2D, 0);
+	render_state_bind_texture(0, 0);
 }
 
 void render_init_quad(ui32 *vao, ui32 *vbo, ui32 *ebo){
@@ -126,7 +204,7 @@ void render_init_quad(ui32 *vao, ui32 *vbo, ui32 *ebo){
 	glGenBuffers(1, vbo);
 	glGenBuffers(1, ebo);
 
-	glBindVertexArray(*vao);
+	render_state_bind_vertex_array(*vao);
 
 	glBindBuffer(GL_ARRAY_BUFFER, *vbo);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
@@ -140,20 +218,34 @@ void render_init_quad(ui32 *vao, ui32 *vbo, ui32 *ebo){
 	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(f32), (void*)(3 * sizeof(f32)));
 	glEnableVertexAttribArray(1);
 
-	glBindVertexArray(0);
+	render_state_bind_vertex_array(0);
 }
 
-void render_init_line(ui32 *vao, ui32 *vbo) {
-	glGenVertexArrays(1, vao);
-	glBindVertexArray(*vao);
+void render_init_render_target(ui32 *fbo, ui32 *texture, ui32 *depth, ui32 width, ui32 height) {
+	if(!*fbo) {
+		glGenFramebuffers(1, fbo);
+		glGenTextures(1, texture);
+		glGenRenderbuffers(1, depth);
+	}
 
-	glGenBuffers(1, vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, *vbo);
-	glBufferData(GL_ARRAY_BUFFER, 6 * sizeof(f32), NULL, GL_DYNAMIC_DRAW);
+	render_state_bind_texture(0, *texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(f32), NULL);
-	glEnableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindRenderbuffer(GL_RENDERBUFFER, *depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, *fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, *texture, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, *depth);
+
+	if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		ERROR_EXIT("Render target %ux%u is incomplete\n", width, height);
+	}
 
-	glBindVertexArray(0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
\ No newline at end of file
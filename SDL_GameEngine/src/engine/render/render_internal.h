@@ -1,14 +1,233 @@
 #pragma once
 
 #include <SDL2/SDL.h>
+#include <linmath.h>
 
 #include "../types.h"
 #include "../render.h"
+#include "../array_list.h"
+#include "../io.h"
 
-SDL_Window *render_init_window(ui32 width, ui32 height);
+// Batch_Vertex.texture_slot holds the texture slot in its low bits and
+// the sprite's palette above them.
+#define RENDER_PALETTE_SHIFT 3
+#define RENDER_TEXTURE_SLOT_MASK 0x7
+
+// Texture unit the palette texture is bound to, past the eight slots.
+#define RENDER_PALETTE_UNIT 8
+
+// Words in a mask of text atlas shelves.
+#define RENDER_TEXT_USAGE_WORDS 2
+
+typedef struct batch_quad {
+	ui32 texture_id;
+	ui16 depth;
+	ui8 layer;
+	ui8 blend_mode;
+	bool is_opaque;
+} Batch_Quad;
+
+typedef struct mesh_draw {
+	ui32 id;
+	ui32 quad_count;
+	ui32 texture_id;
+} Mesh_Draw;
+
+typedef struct mesh_buffers {
+	ui32 vao;
+	ui32 vbo;
+	ui32 quad_count;
+	ui32 generation;
+} Mesh_Buffers;
+
+typedef enum render_capture_mode {
+	RENDER_CAPTURE_NONE,
+	RENDER_CAPTURE_FRAME,
+	RENDER_CAPTURE_LAST
+} Render_Capture_Mode;
+
+// Everything the GL side needs to draw one frame. Filled by the submitting
+// thread, then read by whichever thread owns the GL context.
+typedef struct render_frame {
+	Array_List *vertices;
+	Array_List *quads;
+	Array_List *meshes;
+	Array_List *commands;
+	mat4x4 projection;
+	bool is_sorted;
+	ui8 capture;
+	bool is_video;
+	// Scene to window scale; 0 uses the logical resolution.
+	ui8 upscale;
+	Render_Stats stats;
+	char screenshot_path[256];
+} Render_Frame;
+
+typedef void (*Render_Command_Function)(const void *payload);
+
+// RGBA8 pixels, bottom-up, from a cooked texture when there is one and
+// from the decoded image otherwise.
+typedef struct render_image {
+	const ui8 *pixels;
+	ui32 width;
+	ui32 height;
+	bool is_premultiplied;
+	// Cooked palettized textures also keep their palette and indices.
+	const ui32 *palette;
+	ui32 palette_count;
+	const ui8 *indices;
+	Mapped_File mapping;
+	ui8 *decoded;
+	ui8 *expanded;
+} Render_Image;
+
+// Features of the batch shader. Each combination is compiled as its own
+// program and indexed by its flags, so a batch only pays for what it uses.
+typedef enum render_shader_feature {
+	RENDER_SHADER_TEXTURED = 1 << 0,
+	RENDER_SHADER_TINTED = 1 << 1,
+	RENDER_SHADER_ALPHA_TEST = 1 << 2,
+	RENDER_SHADER_PALETTED = 1 << 3,
+	RENDER_SHADER_VARIANT_COUNT = 1 << 4
+} Render_Shader_Feature;
+
+// Capture files are a header followed by chunks. Textures and meshes are
+// written before the first frame that uses them and again after they change,
+// as are the palettes, all rows in one chunk.
+#define RENDER_CAPTURE_MAGIC 0x50414352
+#define RENDER_CAPTURE_VERSION 2
+
+typedef enum render_capture_chunk_type {
+	RENDER_CAPTURE_CHUNK_TEXTURE,
+	RENDER_CAPTURE_CHUNK_MESH,
+	RENDER_CAPTURE_CHUNK_FRAME,
+	// MAX_RENDER_PALETTES rows of RENDER_PALETTE_SIZE RGBA8 colours.
+	RENDER_CAPTURE_CHUNK_PALETTES
+} Render_Capture_Chunk_Type;
+
+typedef struct render_capture_header {
+	ui32 magic;
+	ui32 version;
+	ui32 vertex_size;
+	ui32 quad_size;
+} Render_Capture_Header;
+
+typedef struct render_capture_chunk {
+	ui32 type;
+	ui32 size;
+} Render_Capture_Chunk;
+
+// Followed by width * height RGBA8 pixels.
+typedef struct render_capture_texture {
+	ui32 texture_id;
+	ui32 width;
+	ui32 height;
+} Render_Capture_Texture;
+
+// Followed by quad_count * 4 vertices.
+typedef struct render_capture_mesh {
+	ui32 id;
+	ui32 quad_count;
+} Render_Capture_Mesh;
+
+// Followed by the frame's vertices, quads and mesh draws.
+typedef struct render_capture_frame {
+	mat4x4 projection;
+	ui32 is_sorted;
+	ui32 quad_count;
+	ui32 mesh_count;
+} Render_Capture_Frame;
+
+SDL_Window *render_init_window(ui32 width, ui32 height, bool is_headless);
+SDL_Window *render_init_window_software(ui32 width, ui32 height, bool is_headless);
 void render_init_color_texture(ui32 *texture);
-void render_init_shaders(ui32 *shader_default, ui32 *shader_batch, f32 render_width, f32 render_height);
+void render_init_shaders(ui32 *shader_default, ui32 shader_batch[RENDER_SHADER_VARIANT_COUNT]);
 void render_init_batch_quads(ui32 *vao, ui32 *vbo, ui32 *ebo);
+void render_init_mesh(ui32 *vao, ui32 *vbo, ui32 ebo);
 void render_init_quad(ui32 *vao, ui32 *bvo, ui32 *ebo);
-void render_init_line(ui32 *vao, ui32 *vbo);
-ui32 render_shader_create(const char *path_vert, const char *path_frag);
\ No newline at end of file
+void render_init_render_target(ui32 *fbo, ui32 *texture, ui32 *depth, ui32 width, ui32 height);
+ui32 render_shader_create(const char *path_vert, const char *path_frag);
+ui32 render_shader_create_variant(const char *path_vert, const char *path_frag, const char *defines);
+ui64 render_shader_cache_key(const char *const *sources, ui32 count);
+bool render_shader_cache_load(ui32 program, const char *name, ui64 key);
+void render_shader_cache_prepare(ui32 program);
+void render_shader_cache_store(ui32 program, const char *name, ui64 key);
+ui16 render_pack_unorm16(f32 value);
+ui8 render_pack_unorm8(f32 value);
+ui32 render_pack_color(const f32 color[4]);
+usize render_batch_emit_sprites(const Sprite_Instance *sprites, usize count, const vec4 view_rect, const Batch_Quad *quad, Batch_Vertex *vertices, Batch_Quad *quads);
+ui32 *render_batch_radix_sort(ui64 *keys, ui32 *indices, ui64 *tmp_keys, ui32 *tmp_indices, usize count);
+void render_batch_append(const Batch_Vertex *vertices, const Batch_Quad *quads, usize count);
+usize render_batch_mark(void);
+usize render_batch_range(usize first, const Batch_Vertex **vertices, const Batch_Quad **quads);
+void render_batch_state(Batch_Quad *quad);
+void render_batch_cull(bool is_enabled);
+
+void render_state_init(void);
+void render_state_invalidate(void);
+void render_state_program_register(ui32 program);
+i32 render_state_uniform_location(ui32 program, const char *name);
+void render_state_use_program(ui32 program);
+void render_state_bind_vertex_array(ui32 vao);
+void render_state_active_texture(ui32 unit);
+void render_state_bind_texture(ui32 unit, ui32 texture);
+void render_state_blend_mode(Render_Blend_Mode blend_mode);
+
+void render_frame_draw(Render_Frame *frame);
+void render_present(SDL_Window *window);
+bool render_thread_is_running(void);
+void render_thread_submit(Render_Frame *frame);
+void render_command_push(Array_List *commands, Render_Command_Function function, const void *payload, usize size);
+void render_command_submit(Render_Command_Function function, const void *payload, usize size);
+void render_command_execute(Array_List *commands);
+void render_mesh_buffers_upload(ui32 id, const Batch_Vertex *vertices, ui32 quad_count);
+void render_sprite_sheet_analyze(Sprite_Sheet *sprite_sheet, const ui8 *image_data);
+bool render_image_info(const char *path, ui32 *width, ui32 *height);
+bool render_image_load(Render_Image *image, const char *path);
+void render_image_free(Render_Image *image);
+void render_texture_load(Sprite_Sheet *sprite_sheet, const char *path);
+void render_texture_uploads(void);
+ui32 render_texture_pending(void);
+void render_texture_shutdown(void);
+
+ui8 render_capture_next(void);
+void render_capture_frame(Render_Frame *frame, const Mesh_Buffers *buffers, usize buffer_count);
+void render_capture_forget_texture(ui32 texture_id);
+
+bool render_video_next(void);
+void render_video_frame(bool is_recorded, ui32 width, ui32 height);
+void render_video_pixels(bool is_recorded, const ui8 *pixels, ui32 width, ui32 height);
+
+void render_stats_frame_begin(Render_Stats *stats);
+void render_stats_frame_begin_soft(Render_Stats *stats);
+void render_stats_pass_time(Render_Pass pass, f32 ms);
+void render_stats_frame_end(void);
+void render_stats_pass_begin(Render_Pass pass);
+void render_stats_pass_end(Render_Pass pass);
+void render_stats_draw(ui32 quad_count);
+void render_stats_upload(ui32 vertex_count, usize bytes);
+void render_stats_flush(void);
+void render_stats_record(const Render_Stats *stats);
+
+void render_soft_init(ui32 width, ui32 height);
+ui32 render_soft_texture_create(const ui8 *pixels, ui32 width, ui32 height, ui32 channel_count);
+void render_soft_mesh_upload(ui32 id, const Batch_Vertex *vertices, ui32 quad_count);
+void render_soft_mesh_destroy(ui32 id);
+void render_soft_draw_frame(Render_Frame *frame, const ui32 *painter);
+void render_soft_resize(ui32 width, ui32 height);
+void render_soft_palette_set(ui16 palette, const ui32 *colors);
+void render_soft_texture_write_alpha(ui32 id, ui32 x, ui32 y, ui32 width, ui32 height, const ui8 *coverage);
+void render_soft_present(SDL_Window *window);
+
+void render_palette_init(bool is_software);
+ui32 render_palette_texture(void);
+ui32 render_palette_generation(void);
+void render_palette_upload(const ui32 *rows);
+ui16 render_palette_create_packed(const ui32 *colors, ui32 count);
+
+void render_text_init(bool is_software);
+void render_text_frame_begin(void);
+void render_text_usage(ui64 used[RENDER_TEXT_USAGE_WORDS]);
+void render_text_usage_reset(void);
+void render_text_touch(const ui64 used[RENDER_TEXT_USAGE_WORDS]);
+ui32 render_text_generation(void);
\ No newline at end of file
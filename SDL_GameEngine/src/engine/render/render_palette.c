@@ -0,0 +1,133 @@
+#include <glad/glad.h>
+#include <string.h>
+
+#include "../util.h"
+#include "../render.h"
+#include "../array_list.h"
+#include "render_internal.h"
+
+// Palettes are rows of RENDER_PALETTE_SIZE colours. The submitting side
+// keeps a copy of each row to build variants from; the GL side keeps all
+// rows in one texture, MAX_RENDER_PALETTES rows high, that the batch
+// shader looks indexed texels up in. Palette ids start at 1 so a zeroed
+// sprite has none.
+
+typedef struct palette_update {
+	ui16 palette;
+	ui32 colors[RENDER_PALETTE_SIZE];
+} Palette_Update;
+
+static Array_List *palettes;
+static ui32 palette_texture;
+static ui32 palette_generation;
+static bool is_software;
+
+void render_palette_init(bool software) {
+	is_software = software;
+	palettes = array_list_create(sizeof(ui32) * RENDER_PALETTE_SIZE, 0);
+	if(!palettes) {
+		ERROR_EXIT("Could not allocate palettes\n");
+	}
+}
+
+static void bind_texture(void) {
+	if(!palette_texture) {
+		glGenTextures(1, &palette_texture);
+		render_state_bind_texture(0, palette_texture);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, RENDER_PALETTE_SIZE, MAX_RENDER_PALETTES, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	}
+
+	render_state_bind_texture(0, palette_texture);
+}
+
+static void update_palette(const void *payload) {
+	const Palette_Update *update = payload;
+
+	if(is_software) {
+		render_soft_palette_set(update->palette, update->colors);
+		return;
+	}
+
+	bind_texture();
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, update->palette - 1, RENDER_PALETTE_SIZE, 1, GL_RGBA, GL_UNSIGNED_BYTE, update->colors);
+	++palette_generation;
+}
+
+static void submit(ui16 palette) {
+	Palette_Update update = {.palette = palette};
+	memcpy(update.colors, array_list_get(palettes, palette - 1), sizeof(update.colors));
+
+	render_command_submit(update_palette, &update, sizeof(update));
+}
+
+// Runs where GL lives.
+ui32 render_palette_texture(void) {
+	return palette_texture;
+}
+
+// Bumped on every upload, for captures to tell when to write the palettes
+// again.
+ui32 render_palette_generation(void) {
+	return palette_generation;
+}
+
+// Replaces every row at once, MAX_RENDER_PALETTES rows of
+// RENDER_PALETTE_SIZE colours, as replay does from a capture.
+void render_palette_upload(const ui32 *rows) {
+	bind_texture();
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, RENDER_PALETTE_SIZE, MAX_RENDER_PALETTES, GL_RGBA, GL_UNSIGNED_BYTE, rows);
+	++palette_generation;
+}
+
+// Colours past count are transparent.
+ui16 render_palette_create_packed(const ui32 *colors, ui32 count) {
+	if(palettes->len == MAX_RENDER_PALETTES) {
+		ERROR_EXIT("Out of palettes, the limit is %u\n", MAX_RENDER_PALETTES);
+	}
+
+	ui32 row[RENDER_PALETTE_SIZE] = {0};
+	memcpy(row, colors, (count < RENDER_PALETTE_SIZE ? count : RENDER_PALETTE_SIZE) * sizeof(ui32));
+
+	ui16 palette = (ui16)array_list_append(palettes, row) + 1;
+	submit(palette);
+
+	return palette;
+}
+
+ui16 render_palette_create(const vec4 *colors, ui32 count) {
+	ui32 row[RENDER_PALETTE_SIZE] = {0};
+	for(ui32 i = 0; i < count && i < RENDER_PALETTE_SIZE; ++i) {
+		row[i] = render_pack_color(colors[i]);
+	}
+
+	return render_palette_create_packed(row, RENDER_PALETTE_SIZE);
+}
+
+// A new palette with the same colours, to make a variant of.
+ui16 render_palette_copy(ui16 palette) {
+	ui32 row[RENDER_PALETTE_SIZE];
+	memcpy(row, array_list_get(palettes, palette - 1), sizeof(row));
+
+	return render_palette_create_packed(row, RENDER_PALETTE_SIZE);
+}
+
+// Swaps every entry that is exactly from for to. Sprites already
+// submitted this frame see the change too. A sheet's own palette should
+// keep its alpha, as the sheet's opacity was worked out from it; replace
+// in a copy to change that.
+void render_palette_replace(ui16 palette, vec4 from, vec4 to) {
+	ui32 *row = array_list_get(palettes, palette - 1);
+	ui32 packed_from = render_pack_color(from);
+	ui32 packed_to = render_pack_color(to);
+
+	for(ui32 i = 0; i < RENDER_PALETTE_SIZE; ++i) {
+		if(row[i] == packed_from) {
+			row[i] = packed_to;
+		}
+	}
+
+	submit(palette);
+}
\ No newline at end of file
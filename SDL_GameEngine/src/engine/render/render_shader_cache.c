@@ -0,0 +1,171 @@
+#include <glad/glad.h>
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../util.h"
+#include "../io.h"
+#include "render_internal.h"
+
+// From ARB_get_program_binary (core in GL 4.1), which glad's 3.3 core
+// loader does not cover.
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+
+typedef void (APIENTRYP Get_Program_Binary)(GLuint program, GLsizei buf_size, GLsizei *length, GLenum *format, void *binary);
+typedef void (APIENTRYP Program_Binary)(GLuint program, GLenum format, const void *binary, GLsizei length);
+typedef void (APIENTRYP Program_Parameteri)(GLuint program, GLenum name, GLint value);
+
+#define SHADER_CACHE_MAGIC 0x48435053
+#define FNV_OFFSET 0xcbf29ce484222325ull
+#define FNV_PRIME 0x100000001b3ull
+
+typedef struct shader_cache_header {
+	ui32 magic;
+	ui32 format;
+	ui64 key;
+	ui32 length;
+} Shader_Cache_Header;
+
+typedef struct shader_cache {
+	Get_Program_Binary get_program_binary;
+	Program_Binary program_binary;
+	Program_Parameteri program_parameteri;
+	ui64 driver_hash;
+	bool is_initialized;
+	bool is_supported;
+} Shader_Cache;
+
+static Shader_Cache cache;
+
+static ui64 hash_string(ui64 hash, const char *string) {
+	for(; *string; ++string) {
+		hash = (hash ^ (ui8)*string) * FNV_PRIME;
+	}
+
+	// Separates consecutive strings so "ab" + "c" differs from "a" + "bc".
+	return (hash ^ 0xFF) * FNV_PRIME;
+}
+
+static void init(void) {
+	cache.is_initialized = true;
+
+	GLint format_count = 0;
+	if(SDL_GL_ExtensionSupported("GL_ARB_get_program_binary")) {
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+	}
+
+	cache.get_program_binary = (Get_Program_Binary)SDL_GL_GetProcAddress("glGetProgramBinary");
+	cache.program_binary = (Program_Binary)SDL_GL_GetProcAddress("glProgramBinary");
+	cache.program_parameteri = (Program_Parameteri)SDL_GL_GetProcAddress("glProgramParameteri");
+	cache.is_supported = format_count > 0 && cache.get_program_binary && cache.program_binary && cache.program_parameteri;
+
+	// Binaries are only valid for the driver that produced them.
+	cache.driver_hash = hash_string(FNV_OFFSET, (const char*)glGetString(GL_VENDOR));
+	cache.driver_hash = hash_string(cache.driver_hash, (const char*)glGetString(GL_RENDERER));
+	cache.driver_hash = hash_string(cache.driver_hash, (const char*)glGetString(GL_VERSION));
+}
+
+static void cache_path(char *path, usize size, const char *name) {
+	snprintf(path, size, "./shaders/cache_%016llx.bin", (unsigned long long)hash_string(FNV_OFFSET, name));
+}
+
+// The key covers everything that makes a binary stale: the sources and
+// the driver.
+ui64 render_shader_cache_key(const char *const *sources, ui32 count) {
+	if(!cache.is_initialized) {
+		init();
+	}
+
+	ui64 key = cache.driver_hash;
+	for(ui32 i = 0; i < count; ++i) {
+		key = hash_string(key, sources[i]);
+	}
+
+	return key;
+}
+
+// Loads the cached binary for name into program. Returns false when there
+// is none, it was built from other sources or another driver, or the
+// driver rejects it; the caller then compiles as usual.
+bool render_shader_cache_load(ui32 program, const char *name, ui64 key) {
+	if(!cache.is_initialized) {
+		init();
+	}
+
+	if(!cache.is_supported) {
+		return false;
+	}
+
+	char path[64];
+	cache_path(path, sizeof(path), name);
+
+	FILE *fp = fopen(path, "rb");
+	if(!fp) {
+		return false;
+	}
+
+	Shader_Cache_Header header;
+	void *binary = NULL;
+	bool is_loaded = fread(&header, sizeof(header), 1, fp) == 1 &&
+		header.magic == SHADER_CACHE_MAGIC && header.key == key &&
+		(binary = malloc(header.length)) != NULL &&
+		fread(binary, header.length, 1, fp) == 1;
+
+	fclose(fp);
+
+	if(is_loaded) {
+		cache.program_binary(program, header.format, binary, header.length);
+
+		GLint success;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		is_loaded = success;
+	}
+
+	free(binary);
+
+	return is_loaded;
+}
+
+// Saves a linked program's binary. Call render_shader_cache_prepare
+// before linking so the driver keeps it retrievable.
+void render_shader_cache_store(ui32 program, const char *name, ui64 key) {
+	if(!cache.is_supported) {
+		return;
+	}
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if(length <= 0) {
+		return;
+	}
+
+	ui8 *data = malloc(sizeof(Shader_Cache_Header) + length);
+	if(!data) {
+		return;
+	}
+
+	Shader_Cache_Header *header = (Shader_Cache_Header*)data;
+	GLenum format;
+	cache.get_program_binary(program, length, NULL, &format, data + sizeof(Shader_Cache_Header));
+
+	*header = (Shader_Cache_Header){
+		.magic = SHADER_CACHE_MAGIC,
+		.format = format,
+		.key = key,
+		.length = (ui32)length
+	};
+
+	char path[64];
+	cache_path(path, sizeof(path), name);
+	io_file_write(data, sizeof(Shader_Cache_Header) + length, path);
+
+	free(data);
+}
+
+void render_shader_cache_prepare(ui32 program) {
+	if(cache.is_supported) {
+		cache.program_parameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,470 @@
+#include <SDL2/SDL.h>
+#include <string.h>
+#include <math.h>
+
+#include "../util.h"
+#include "../job.h"
+#include "../array_list.h"
+#include "render_internal.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RENDER_SOFT_SSE2
+#include <emmintrin.h>
+#endif
+
+// Rows per tile. Tiles span the full width and are rasterized in parallel.
+#define SOFT_TILE_ROWS 32
+
+typedef struct soft_texture {
+	ui32 width;
+	ui32 height;
+	ui32 *texels;
+} Soft_Texture;
+
+typedef struct soft_mesh {
+	Batch_Vertex *vertices;
+	ui32 quad_count;
+} Soft_Mesh;
+
+// A quad in pixel space. Axis-aligned quads, which is every sprite, are
+// filled span by span with nearest sampling. Anything else (rotated line
+// segments) is filled untextured with edge tests.
+typedef struct soft_quad {
+	i32 x0;
+	i32 y0;
+	i32 x1;
+	i32 y1;
+	f32 u;
+	f32 v;
+	f32 du;
+	f32 dv;
+	vec2 corners[4];
+	ui32 color;
+	const Soft_Texture *texture;
+	const ui32 *palette;
+	ui8 blend_mode;
+	bool is_axis_aligned;
+} Soft_Quad;
+
+typedef struct soft_state {
+	ui32 width;
+	ui32 height;
+	ui32 *pixels;
+	Array_List *textures;
+	Array_List *meshes;
+	Array_List *quads;
+	ui32 palettes[MAX_RENDER_PALETTES][RENDER_PALETTE_SIZE];
+} Soft_State;
+
+static Soft_State soft;
+
+void render_soft_init(ui32 width, ui32 height) {
+	soft.width = width;
+	soft.height = height;
+	soft.pixels = calloc((usize)width * height, sizeof(ui32));
+	soft.textures = array_list_create(sizeof(Soft_Texture), 1);
+	soft.meshes = array_list_create(sizeof(Soft_Mesh), 1);
+	soft.quads = array_list_create(sizeof(Soft_Quad), 0);
+	if(!soft.pixels || !soft.textures || !soft.meshes || !soft.quads) {
+		ERROR_EXIT("Could not allocate %ux%u software target\n", width, height);
+	}
+
+	// Id 0 is the untextured white texture, as in the GL backend.
+	array_list_append(soft.textures, &(Soft_Texture){0});
+}
+
+ui32 render_soft_texture_create(const ui8 *pixels, ui32 width, ui32 height, ui32 channel_count) {
+	Soft_Texture texture = {
+		.width = width,
+		.height = height,
+		.texels = malloc((usize)width * height * sizeof(ui32))
+	};
+
+	if(!texture.texels) {
+		ERROR_EXIT("Could not allocate %ux%u software texture\n", width, height);
+	}
+
+	// Indexed textures keep the index and resolve it when sampled.
+	for(usize i = 0; i < (usize)width * height; ++i) {
+		if(channel_count == 1) {
+			texture.texels[i] = pixels[i];
+			continue;
+		}
+
+		const ui8 *p = &pixels[i * channel_count];
+		ui8 texel[4] = {p[0], p[1], p[2], channel_count == 4 ? p[3] : 255};
+		memcpy(&texture.texels[i], texel, sizeof(ui32));
+	}
+
+	return (ui32)array_list_append(soft.textures, &texture);
+}
+
+// Writes white texels with the coverage as alpha, as the GL backend
+// swizzles its glyph atlas.
+void render_soft_texture_write_alpha(ui32 id, ui32 x, ui32 y, ui32 width, ui32 height, const ui8 *coverage) {
+	Soft_Texture *texture = array_list_get(soft.textures, id);
+
+	for(ui32 row = 0; row < height; ++row) {
+		ui32 *texels = &texture->texels[(y + row) * texture->width + x];
+
+		for(ui32 column = 0; column < width; ++column) {
+			ui8 texel[4] = {255, 255, 255, coverage[row * width + column]};
+			memcpy(&texels[column], texel, sizeof(ui32));
+		}
+	}
+}
+
+void render_soft_palette_set(ui16 palette, const ui32 *colors) {
+	memcpy(soft.palettes[palette - 1], colors, sizeof(soft.palettes[0]));
+}
+
+void render_soft_mesh_upload(ui32 id, const Batch_Vertex *vertices, ui32 quad_count) {
+	while(soft.meshes->len <= id) {
+		array_list_append(soft.meshes, &(Soft_Mesh){0});
+	}
+
+	Soft_Mesh *mesh = array_list_get(soft.meshes, id);
+	Batch_Vertex *copy = realloc(mesh->vertices, (usize)quad_count * 4 * sizeof(Batch_Vertex) + 1);
+	if(!copy) {
+		ERROR_EXIT("Could not allocate software mesh of %u quads\n", quad_count);
+	}
+
+	memcpy(copy, vertices, (usize)quad_count * 4 * sizeof(Batch_Vertex));
+	mesh->vertices = copy;
+	mesh->quad_count = quad_count;
+}
+
+void render_soft_mesh_destroy(ui32 id) {
+	if(id >= soft.meshes->len) {
+		return;
+	}
+
+	Soft_Mesh *mesh = array_list_get(soft.meshes, id);
+	free(mesh->vertices);
+	*mesh = (Soft_Mesh){0};
+}
+
+// Frames under dynamic resolution are drawn smaller and upscaled further
+// when shown.
+void render_soft_resize(ui32 width, ui32 height) {
+	if(width == soft.width && height == soft.height) {
+		return;
+	}
+
+	ui32 *pixels = realloc(soft.pixels, (usize)width * height * sizeof(ui32));
+	if(!pixels) {
+		ERROR_EXIT("Could not resize software target to %ux%u\n", width, height);
+	}
+
+	soft.pixels = pixels;
+	soft.width = width;
+	soft.height = height;
+}
+
+const ui8 *render_soft_pixels(void) {
+	return (const ui8*)soft.pixels;
+}
+
+static void to_pixel(const mat4x4 projection, const vec2 position, vec2 result) {
+	vec4 clip;
+	mat4x4_mul_vec4(clip, projection, (vec4){position[0], position[1], 0, 1});
+
+	result[0] = (clip[0] + 1) * 0.5f * soft.width;
+	result[1] = (1 - clip[1]) * 0.5f * soft.height;
+}
+
+static ui32 pack_rgba(const ui8 color[4]) {
+	ui32 packed;
+	memcpy(&packed, color, sizeof(packed));
+	return packed;
+}
+
+// Pixel centers inside [min, max) are covered.
+static i32 first_pixel(f32 edge) {
+	return (i32)ceilf(edge - 0.5f);
+}
+
+static void add_quad(const mat4x4 projection, const Batch_Vertex *v, ui32 texture_id, ui8 blend_mode) {
+	Soft_Quad quad = {
+		.color = pack_rgba(v[0].color),
+		.blend_mode = blend_mode,
+		.is_axis_aligned = v[0].position[1] == v[1].position[1] && v[1].position[0] == v[2].position[0] &&
+			v[2].position[1] == v[3].position[1] && v[3].position[0] == v[0].position[0]
+	};
+
+	f32 min_x = INFINITY, min_y = INFINITY, max_x = -INFINITY, max_y = -INFINITY;
+	for(ui32 i = 0; i < 4; ++i) {
+		to_pixel(projection, v[i].position, quad.corners[i]);
+		min_x = fminf(min_x, quad.corners[i][0]);
+		min_y = fminf(min_y, quad.corners[i][1]);
+		max_x = fmaxf(max_x, quad.corners[i][0]);
+		max_y = fmaxf(max_y, quad.corners[i][1]);
+	}
+
+	quad.x0 = first_pixel(min_x);
+	quad.y0 = first_pixel(min_y);
+	quad.x1 = first_pixel(max_x);
+	quad.y1 = first_pixel(max_y);
+
+	if(quad.x1 <= 0 || quad.y1 <= 0 || quad.x0 >= (i32)soft.width || quad.y0 >= (i32)soft.height || quad.x0 >= quad.x1 || quad.y0 >= quad.y1) {
+		return;
+	}
+
+	if(texture_id != 0 && texture_id < soft.textures->len && quad.is_axis_aligned) {
+		quad.texture = array_list_get(soft.textures, texture_id);
+
+		ui32 palette = v[0].texture_slot >> RENDER_PALETTE_SHIFT;
+		if(palette) {
+			quad.palette = soft.palettes[palette - 1];
+		}
+
+		// Corner 0 and corner 2 are opposite; interpolate UVs between them.
+		f32 u0 = v[0].uvs[0] / 65535.f, v0 = v[0].uvs[1] / 65535.f;
+		f32 u2 = v[2].uvs[0] / 65535.f, v2 = v[2].uvs[1] / 65535.f;
+		quad.du = (u2 - u0) / (quad.corners[2][0] - quad.corners[0][0]);
+		quad.dv = (v2 - v0) / (quad.corners[2][1] - quad.corners[0][1]);
+		quad.u = u0 + (quad.x0 + 0.5f - quad.corners[0][0]) * quad.du;
+		quad.v = v0 + (quad.y0 + 0.5f - quad.corners[0][1]) * quad.dv;
+	}
+
+	array_list_append(soft.quads, &quad);
+}
+
+static ui32 sample(const Soft_Quad *quad, f32 u, f32 v) {
+	const Soft_Texture *texture = quad->texture;
+	i32 x = (i32)(u * texture->width);
+	i32 y = (i32)(v * texture->height);
+	x = x < 0 ? 0 : x >= (i32)texture->width ? (i32)texture->width - 1 : x;
+	y = y < 0 ? 0 : y >= (i32)texture->height ? (i32)texture->height - 1 : y;
+
+	ui32 texel = texture->texels[y * texture->width + x];
+	return quad->palette ? quad->palette[texel & 0xFF] : texel;
+}
+
+static ui32 div255(ui32 x) {
+	return (x + 128 + ((x + 128) >> 8)) >> 8;
+}
+
+// Straight alpha, matching the GL blend functions for each mode.
+static ui32 blend_pixel(ui32 texel, ui32 color, ui32 destination, ui8 blend_mode) {
+	ui8 s[4], c[4], d[4], out[4];
+	memcpy(s, &texel, 4);
+	memcpy(c, &color, 4);
+	memcpy(d, &destination, 4);
+
+	for(ui32 i = 0; i < 4; ++i) {
+		s[i] = (ui8)div255(s[i] * c[i]);
+	}
+
+	ui32 a = s[3];
+
+	if(blend_mode == RENDER_BLEND_ADDITIVE) {
+		for(ui32 i = 0; i < 3; ++i) {
+			ui32 value = d[i] + div255(s[i] * a);
+			out[i] = value > 255 ? 255 : (ui8)value;
+		}
+		out[3] = d[3];
+	} else {
+		ui32 source_factor = blend_mode == RENDER_BLEND_PREMULTIPLIED ? 255 : a;
+		for(ui32 i = 0; i < 3; ++i) {
+			out[i] = (ui8)div255(s[i] * source_factor + d[i] * (255 - a));
+		}
+		out[3] = (ui8)(a + div255(d[3] * (255 - a)));
+	}
+
+	ui32 result;
+	memcpy(&result, out, 4);
+	return result;
+}
+
+#ifdef RENDER_SOFT_SSE2
+
+static __m128i div255_epi16(__m128i x) {
+	x = _mm_add_epi16(x, _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+// Alpha blends two pixels unpacked to 16 bits per channel. The alpha lane
+// takes no source factor and gets the source alpha added back afterwards,
+// which keeps every product sum within 16 bits.
+static __m128i blend_alpha_epi16(__m128i s, __m128i d) {
+	const __m128i rgb_mask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+	__m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xFF), 0xFF);
+	__m128i inverse = _mm_sub_epi16(_mm_set1_epi16(255), a);
+	__m128i sum = _mm_add_epi16(_mm_mullo_epi16(s, _mm_and_si128(a, rgb_mask)), _mm_mullo_epi16(d, inverse));
+
+	return _mm_add_epi16(div255_epi16(sum), _mm_andnot_si128(rgb_mask, s));
+}
+
+static void blend_alpha_4(ui32 *destination, const ui32 texels[4], __m128i color) {
+	const __m128i zero = _mm_setzero_si128();
+	__m128i s = _mm_loadu_si128((const __m128i*)texels);
+	__m128i d = _mm_loadu_si128((const __m128i*)destination);
+
+	__m128i s_lo = div255_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), color));
+	__m128i s_hi = div255_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), color));
+	__m128i out_lo = blend_alpha_epi16(s_lo, _mm_unpacklo_epi8(d, zero));
+	__m128i out_hi = blend_alpha_epi16(s_hi, _mm_unpackhi_epi8(d, zero));
+
+	_mm_storeu_si128((__m128i*)destination, _mm_packus_epi16(out_lo, out_hi));
+}
+
+#endif
+
+static void fill_span(const Soft_Quad *quad, ui32 *row, i32 x0, i32 x1, f32 v) {
+	ui32 texels[4];
+	f32 u = quad->u + (x0 - quad->x0) * quad->du;
+	i32 x = x0;
+
+#ifdef RENDER_SOFT_SSE2
+	if(quad->blend_mode == RENDER_BLEND_ALPHA) {
+		const __m128i color = _mm_unpacklo_epi8(_mm_cvtsi32_si128((i32)quad->color), _mm_setzero_si128());
+		const __m128i color_2 = _mm_unpacklo_epi64(color, color);
+
+		for(; x + 4 <= x1; x += 4) {
+			for(ui32 i = 0; i < 4; ++i, u += quad->du) {
+				texels[i] = quad->texture ? sample(quad, u, v) : 0xFFFFFFFF;
+			}
+
+			blend_alpha_4(&row[x], texels, color_2);
+		}
+	}
+#endif
+
+	for(; x < x1; ++x, u += quad->du) {
+		ui32 texel = quad->texture ? sample(quad, u, v) : 0xFFFFFFFF;
+		row[x] = blend_pixel(texel, quad->color, row[x], quad->blend_mode);
+	}
+}
+
+static f32 edge(const vec2 a, const vec2 b, f32 x, f32 y) {
+	return (b[0] - a[0]) * (y - a[1]) - (b[1] - a[1]) * (x - a[0]);
+}
+
+static void fill_general(const Soft_Quad *quad, ui32 *row, i32 y, i32 x0, i32 x1) {
+	f32 py = y + 0.5f;
+	f32 winding = edge(quad->corners[0], quad->corners[1], quad->corners[2][0], quad->corners[2][1]) > 0 ? 1 : -1;
+
+	for(i32 x = x0; x < x1; ++x) {
+		f32 px = x + 0.5f;
+		bool is_inside = true;
+
+		for(ui32 i = 0; i < 4 && is_inside; ++i) {
+			is_inside = edge(quad->corners[i], quad->corners[(i + 1) & 3], px, py) * winding >= 0;
+		}
+
+		if(is_inside) {
+			row[x] = blend_pixel(0xFFFFFFFF, quad->color, row[x], quad->blend_mode);
+		}
+	}
+}
+
+static void raster_tile(void *data, ui32 slice, usize begin, usize end) {
+	(void)data;
+	(void)slice;
+
+	const Soft_Quad *quads = soft.quads->items;
+	const ui8 clear[4] = {20, 26, 26, 255};
+	ui32 clear_color = pack_rgba(clear);
+
+	for(usize tile = begin; tile < end; ++tile) {
+		i32 tile_y0 = (i32)tile * SOFT_TILE_ROWS;
+		i32 tile_y1 = tile_y0 + SOFT_TILE_ROWS < (i32)soft.height ? tile_y0 + SOFT_TILE_ROWS : (i32)soft.height;
+
+		for(i32 y = tile_y0; y < tile_y1; ++y) {
+			ui32 *row = &soft.pixels[(usize)y * soft.width];
+			for(ui32 x = 0; x < soft.width; ++x) {
+				row[x] = clear_color;
+			}
+		}
+
+		for(usize i = 0; i < soft.quads->len; ++i) {
+			const Soft_Quad *quad = &quads[i];
+			if(quad->y1 <= tile_y0 || quad->y0 >= tile_y1) {
+				continue;
+			}
+
+			i32 y0 = quad->y0 > tile_y0 ? quad->y0 : tile_y0;
+			i32 y1 = quad->y1 < tile_y1 ? quad->y1 : tile_y1;
+			i32 x0 = quad->x0 > 0 ? quad->x0 : 0;
+			i32 x1 = quad->x1 < (i32)soft.width ? quad->x1 : (i32)soft.width;
+
+			for(i32 y = y0; y < y1; ++y) {
+				ui32 *row = &soft.pixels[(usize)y * soft.width];
+
+				if(quad->is_axis_aligned) {
+					fill_span(quad, row, x0, x1, quad->v + (y - quad->y0) * quad->dv);
+				} else {
+					fill_general(quad, row, y, x0, x1);
+				}
+			}
+		}
+	}
+}
+
+// Meshes first, then the batch in painter order, matching the GL backend's
+// result without a depth buffer.
+void render_soft_draw_frame(Render_Frame *frame, const ui32 *painter) {
+	soft.quads->len = 0;
+
+	const Mesh_Draw *meshes = frame->meshes->items;
+	for(usize i = 0; i < frame->meshes->len; ++i) {
+		if(meshes[i].id >= soft.meshes->len) {
+			continue;
+		}
+
+		const Soft_Mesh *mesh = array_list_get(soft.meshes, meshes[i].id);
+		for(ui32 q = 0; q < mesh->quad_count; ++q) {
+			add_quad(frame->projection, &mesh->vertices[q * 4], meshes[i].texture_id, RENDER_BLEND_ALPHA);
+		}
+	}
+
+	const Batch_Vertex *vertices = frame->vertices->items;
+	const Batch_Quad *quads = frame->quads->items;
+	for(usize i = 0; i < frame->quads->len; ++i) {
+		const Batch_Quad *quad = &quads[painter[i]];
+		add_quad(frame->projection, &vertices[painter[i] * 4], quad->texture_id, quad->blend_mode);
+	}
+
+	render_stats_draw((ui32)soft.quads->len);
+
+	// Every quad is rasterized in one painter-ordered pass, timed as the
+	// translucent one.
+	ui64 start = SDL_GetPerformanceCounter();
+	ui32 tile_count = (soft.height + SOFT_TILE_ROWS - 1) / SOFT_TILE_ROWS;
+	job_parallel_for(tile_count, tile_count < MAX_JOB_THREADS ? tile_count : MAX_JOB_THREADS, raster_tile, NULL);
+	render_stats_pass_time(RENDER_PASS_TRANSLUCENT, (f32)((f64)(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency()));
+}
+
+void render_soft_present(SDL_Window *window) {
+	if(!window) {
+		return;
+	}
+
+	SDL_Surface *surface = SDL_GetWindowSurface(window);
+	if(!surface) {
+		return;
+	}
+
+	SDL_Surface *scene = SDL_CreateRGBSurfaceWithFormatFrom(soft.pixels, soft.width, soft.height, 32, soft.width * 4, SDL_PIXELFORMAT_RGBA32);
+	if(!scene) {
+		return;
+	}
+
+	SDL_SetSurfaceBlendMode(scene, SDL_BLENDMODE_NONE);
+
+	// Whole-factor nearest upscale, centred like the GL backend.
+	i32 upscale = surface->w / (i32)soft.width < surface->h / (i32)soft.height ? surface->w / (i32)soft.width : surface->h / (i32)soft.height;
+	upscale = upscale > 0 ? upscale : 1;
+
+	SDL_Rect rect = {
+		.w = soft.width * upscale,
+		.h = soft.height * upscale
+	};
+	rect.x = (surface->w - rect.w) / 2;
+	rect.y = (surface->h - rect.h) / 2;
+
+	SDL_BlitScaled(scene, NULL, surface, &rect);
+	SDL_FreeSurface(scene);
+	SDL_UpdateWindowSurface(window);
+}
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include <glad/glad.h>
+#include <string.h>
+
+#include "../util.h"
+#include "../array_list.h"
+#include "render_internal.h"
+
+#define STATE_UNKNOWN 0xFFFFFFFF
+#define MAX_TEXTURE_UNITS 16
+#define MAX_UNIFORM_NAME 32
+
+typedef struct uniform_entry {
+	ui32 program;
+	i32 location;
+	char name[MAX_UNIFORM_NAME];
+} Uniform_Entry;
+
+static Array_List *uniform_list;
+
+static ui32 current_program = STATE_UNKNOWN;
+static ui32 current_vao = STATE_UNKNOWN;
+static ui32 current_unit = STATE_UNKNOWN;
+static ui32 current_textures[MAX_TEXTURE_UNITS];
+static ui32 current_blend_mode = STATE_UNKNOWN;
+
+static Render_State_Counters counters;
+
+void render_state_invalidate(void) {
+	current_program = STATE_UNKNOWN;
+	current_vao = STATE_UNKNOWN;
+	current_unit = STATE_UNKNOWN;
+	current_blend_mode = STATE_UNKNOWN;
+
+	for(ui32 i = 0; i < MAX_TEXTURE_UNITS; ++i) {
+		current_textures[i] = STATE_UNKNOWN;
+	}
+}
+
+void render_state_init(void) {
+	uniform_list = array_list_create(sizeof(Uniform_Entry), 16);
+	render_state_invalidate();
+}
+
+void render_state_program_register(ui32 program) {
+	i32 uniform_count = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniform_count);
+
+	for(i32 i = 0; i < uniform_count; ++i) {
+		Uniform_Entry entry = {.program = program};
+		GLint size;
+		GLenum type;
+
+		glGetActiveUniform(program, i, MAX_UNIFORM_NAME, NULL, &size, &type, entry.name);
+		entry.location = glGetUniformLocation(program, entry.name);
+
+		// Arrays are reported as "name[0]"; store them under their plain name.
+		char *bracket = strchr(entry.name, '[');
+		if(bracket) {
+			*bracket = 0;
+		}
+
+		if(array_list_append(uniform_list, &entry) == (usize)-1) {
+			ERROR_EXIT("Could not append uniform to list\n");
+		}
+	}
+}
+
+i32 render_state_uniform_location(ui32 program, const char *name) {
+	Uniform_Entry *entries = uniform_list->items;
+
+	for(usize i = 0; i < uniform_list->len; ++i) {
+		if(entries[i].program == program && strcmp(entries[i].name, name) == 0) {
+			return entries[i].location;
+		}
+	}
+
+	return -1;
+}
+
+void render_state_use_program(ui32 program) {
+	if(current_program == program) {
+		++counters.skipped;
+		return;
+	}
+
+	glUseProgram(program);
+	current_program = program;
+	++counters.issued;
+}
+
+void render_state_bind_vertex_array(ui32 vao) {
+	if(current_vao == vao) {
+		++counters.skipped;
+		return;
+	}
+
+	glBindVertexArray(vao);
+	current_vao = vao;
+	++counters.issued;
+}
+
+void render_state_active_texture(ui32 unit) {
+	if(current_unit == unit) {
+		++counters.skipped;
+		return;
+	}
+
+	glActiveTexture(GL_TEXTURE0 + unit);
+	current_unit = unit;
+	++counters.issued;
+}
+
+void render_state_bind_texture(ui32 unit, ui32 texture) {
+	if(current_textures[unit] == texture) {
+		++counters.skipped;
+		return;
+	}
+
+	render_state_active_texture(unit);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	current_textures[unit] = texture;
+	++counters.issued;
+}
+
+void render_state_blend_mode(Render_Blend_Mode blend_mode) {
+	if(current_blend_mode == blend_mode) {
+		++counters.skipped;
+		return;
+	}
+
+	switch(blend_mode) {
+		case RENDER_BLEND_ALPHA: glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA); break;
+		case RENDER_BLEND_ADDITIVE: glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE, GL_ZERO, GL_ONE); break;
+		case RENDER_BLEND_PREMULTIPLIED: glBlendFuncSeparate(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA); break;
+	}
+
+	current_blend_mode = blend_mode;
+	++counters.issued;
+}
+
+Render_State_Counters render_state_counters(void) {
+	return counters;
+}
+
+void render_state_counters_reset(void) {
+	counters = (Render_State_Counters){0};
+}
\ No newline at end of file
@@ -0,0 +1,144 @@
+#include <glad/glad.h>
+#include <stdio.h>
+
+#include "../util.h"
+#include "../render.h"
+#include "render_internal.h"
+
+typedef struct query_frame {
+	ui32 queries[RENDER_PASS_COUNT];
+	bool is_issued[RENDER_PASS_COUNT];
+} Query_Frame;
+
+static Query_Frame query_frames[RENDER_QUERY_LATENCY];
+static ui32 query_index;
+static bool has_queries;
+static i32 active_pass = -1;
+// Counts made outside a frame, such as mesh uploads before the first
+// render_begin or from replay, land in scratch and are dropped.
+static Render_Stats scratch;
+static Render_Stats *current = &scratch;
+
+static Render_Stats history[RENDER_STATS_HISTORY];
+static ui32 history_index;
+
+// Reuses the queries issued RENDER_QUERY_LATENCY frames ago. By now their
+// results are normally ready; any that are not are reported as 0 rather
+// than stalling.
+void render_stats_frame_begin(Render_Stats *stats) {
+	if(!has_queries) {
+		for(ui32 i = 0; i < RENDER_QUERY_LATENCY; ++i) {
+			glGenQueries(RENDER_PASS_COUNT, query_frames[i].queries);
+		}
+		has_queries = true;
+	}
+
+	current = stats;
+	*current = (Render_Stats){0};
+	render_state_counters_reset();
+
+	Query_Frame *query_frame = &query_frames[query_index];
+
+	for(ui32 pass = 0; pass < RENDER_PASS_COUNT; ++pass) {
+		if(!query_frame->is_issued[pass]) {
+			continue;
+		}
+
+		i32 is_available = 0;
+		glGetQueryObjectiv(query_frame->queries[pass], GL_QUERY_RESULT_AVAILABLE, &is_available);
+
+		if(is_available) {
+			ui64 elapsed;
+			glGetQueryObjectui64v(query_frame->queries[pass], GL_QUERY_RESULT, &elapsed);
+			current->gpu_ms[pass] = (f32)(elapsed / 1000000.0);
+		}
+
+		query_frame->is_issued[pass] = false;
+	}
+}
+
+// The software backend has no queries. It times its passes on the CPU
+// with render_stats_pass_time, so its times belong to the frame itself.
+void render_stats_frame_begin_soft(Render_Stats *stats) {
+	current = stats;
+	*current = (Render_Stats){0};
+	render_state_counters_reset();
+}
+
+void render_stats_pass_time(Render_Pass pass, f32 ms) {
+	current->gpu_ms[pass] += ms;
+}
+
+void render_stats_frame_end(void) {
+	Render_State_Counters counters = render_state_counters();
+
+	current->state_changes = counters.issued;
+	current->state_changes_skipped = counters.skipped;
+	current = &scratch;
+	query_index = (query_index + 1) % RENDER_QUERY_LATENCY;
+}
+
+// Only one time query can run at a time, so a pass started inside another
+// (the batch passes while building the static layer) is timed as part of
+// the outer one.
+void render_stats_pass_begin(Render_Pass pass) {
+	if(active_pass >= 0) {
+		return;
+	}
+
+	Query_Frame *query_frame = &query_frames[query_index];
+	glBeginQuery(GL_TIME_ELAPSED, query_frame->queries[pass]);
+	query_frame->is_issued[pass] = true;
+	active_pass = pass;
+}
+
+void render_stats_pass_end(Render_Pass pass) {
+	if(active_pass != (i32)pass) {
+		return;
+	}
+
+	glEndQuery(GL_TIME_ELAPSED);
+	active_pass = -1;
+}
+
+void render_stats_draw(ui32 quad_count) {
+	++current->draw_calls;
+	current->quads += quad_count;
+}
+
+void render_stats_upload(ui32 vertex_count, usize bytes) {
+	current->vertices_uploaded += vertex_count;
+	current->bytes_uploaded += (ui32)bytes;
+}
+
+void render_stats_flush(void) {
+	++current->flushes;
+}
+
+void render_stats_record(const Render_Stats *stats) {
+	history[history_index] = *stats;
+	history_index = (history_index + 1) % RENDER_STATS_HISTORY;
+}
+
+// Recorded stats, oldest first.
+void render_stats_history(Render_Stats result[RENDER_STATS_HISTORY]) {
+	for(ui32 i = 0; i < RENDER_STATS_HISTORY; ++i) {
+		result[i] = history[(history_index + i) % RENDER_STATS_HISTORY];
+	}
+}
+
+// The latest recorded stats as text, one line per group. Drawn after
+// ui_stats_graph it shares the graph's batch.
+void render_stats_text(ui32 font, vec2 position) {
+	const Render_Stats *stats = &history[(history_index + RENDER_STATS_HISTORY - 1) % RENDER_STATS_HISTORY];
+	f32 gpu_ms = 0;
+	for(ui32 pass = 0; pass < RENDER_PASS_COUNT; ++pass) {
+		gpu_ms += stats->gpu_ms[pass];
+	}
+
+	char text[256];
+	snprintf(text, sizeof(text), "draws %u quads %u\nupload %u KB\nstate %u skipped %u\ngpu %.2f ms",
+		stats->draw_calls, stats->quads, stats->bytes_uploaded / 1024, stats->state_changes, stats->state_changes_skipped, gpu_ms);
+
+	render_text(font, text, position, (vec4){1, 1, 1, 1});
+}
\ No newline at end of file
@@ -0,0 +1,515 @@
+#include <glad/glad.h>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include <string.h>
+#include <math.h>
+
+#include "../util.h"
+#include "../render.h"
+#include "../array_list.h"
+#include "render_internal.h"
+
+// Glyphs of every font share one coverage atlas. It is packed in shelves,
+// rows of glyphs of similar height. When it is full, the shelf used
+// longest ago is cleared for reuse; its glyphs are rasterized again if
+// they are drawn later. Shelves used in the current or previous frame are
+// never cleared, so steady text never rasterizes anything, and text kept
+// as retained geometry stays valid while it is touched every frame.
+#define TEXT_ATLAS_SIZE 1024
+#define TEXT_MAX_SHELVES (RENDER_TEXT_USAGE_WORDS * 64)
+#define TEXT_GLYPH_PADDING 1
+
+// Kerning pairs are cached per font in a direct-mapped table.
+#define TEXT_KERNING_CACHE_SIZE 1024
+
+typedef struct text_shelf {
+	ui16 y;
+	ui16 height;
+	ui16 x;
+	ui16 generation;
+	ui32 last_used;
+} Text_Shelf;
+
+typedef struct text_glyph {
+	ui32 codepoint;
+	ui32 glyph_index;
+	i16 advance;
+	i16 left;
+	i16 top;
+	ui16 width;
+	ui16 height;
+	// Where the glyph is in the atlas, valid while the shelf's generation
+	// still matches.
+	ui16 x;
+	ui16 y;
+	ui16 shelf;
+	ui16 generation;
+	// Set once rasterized with an empty bitmap, like a space, which needs
+	// no atlas space and is never rasterized again.
+	bool is_empty;
+	bool is_used;
+} Text_Glyph;
+
+typedef struct text_kerning {
+	ui64 pair;
+	i16 kerning;
+	bool is_valid;
+} Text_Kerning;
+
+typedef struct text_font {
+	FT_Face face;
+	f32 line_height;
+	bool has_kerning;
+	// Open addressing on the codepoint, grown at half full.
+	Text_Glyph *glyphs;
+	ui32 glyph_capacity;
+	ui32 glyph_count;
+	Text_Kerning kerning[TEXT_KERNING_CACHE_SIZE];
+} Text_Font;
+
+typedef struct glyph_upload {
+	ui16 x;
+	ui16 y;
+	ui16 width;
+	ui16 height;
+} Glyph_Upload;
+
+typedef struct render_text_state {
+	FT_Library library;
+	Array_List *fonts;
+	Array_List *sprites;
+	ui32 texture_id;
+	bool is_software;
+	Text_Shelf shelves[TEXT_MAX_SHELVES];
+	ui32 shelf_count;
+	ui32 frame;
+	// Shelves drawn from since the last render_text_usage, one bit each.
+	ui64 used[RENDER_TEXT_USAGE_WORDS];
+	// Bumped whenever a shelf is cleared.
+	ui32 generation;
+} Render_Text_State;
+
+static Render_Text_State text;
+
+void render_text_init(bool is_software) {
+	text.is_software = is_software;
+
+	if(FT_Init_FreeType(&text.library)) {
+		ERROR_EXIT("Could not initialize FreeType\n");
+	}
+
+	text.fonts = array_list_create(sizeof(Text_Font*), 0);
+	text.sprites = array_list_create(sizeof(Sprite_Instance), 256);
+	if(!text.fonts || !text.sprites) {
+		ERROR_EXIT("Could not allocate text state\n");
+	}
+
+	if(text.is_software) {
+		ui8 *pixels = calloc((usize)TEXT_ATLAS_SIZE * TEXT_ATLAS_SIZE, 4);
+		if(!pixels) {
+			ERROR_EXIT("Could not allocate text atlas\n");
+		}
+
+		text.texture_id = render_soft_texture_create(pixels, TEXT_ATLAS_SIZE, TEXT_ATLAS_SIZE, 4);
+		free(pixels);
+		return;
+	}
+
+	// Coverage only, read back as white with the coverage as alpha so the
+	// batch shader tints it like any sprite.
+	glGenTextures(1, &text.texture_id);
+	render_state_bind_texture(0, text.texture_id);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_ONE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_ONE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_ONE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, GL_RED);
+
+	ui8 *zeros = calloc((usize)TEXT_ATLAS_SIZE * TEXT_ATLAS_SIZE, 1);
+	if(!zeros) {
+		ERROR_EXIT("Could not allocate text atlas\n");
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, TEXT_ATLAS_SIZE, TEXT_ATLAS_SIZE, 0, GL_RED, GL_UNSIGNED_BYTE, zeros);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	free(zeros);
+}
+
+// Loads a font at one pixel size and returns its id. Like textures, fonts
+// must be loaded before the render thread starts; their glyphs are added
+// to the atlas whenever they are first drawn.
+ui32 render_font_load(const char *path, ui32 pixel_size) {
+	if(render_thread_is_running()) {
+		ERROR_EXIT("Font %s must be loaded before the render thread starts\n", path);
+	}
+
+	Text_Font *font = calloc(1, sizeof(Text_Font));
+	if(!font) {
+		ERROR_EXIT("Could not allocate font %s\n", path);
+	}
+
+	if(FT_New_Face(text.library, path, 0, &font->face)) {
+		ERROR_EXIT("Failed to load font: %s\n", path);
+	}
+
+	if(FT_Set_Pixel_Sizes(font->face, 0, pixel_size)) {
+		ERROR_EXIT("Font %s has no %upx size\n", path, pixel_size);
+	}
+
+	font->line_height = font->face->size->metrics.height / 64.f;
+	font->has_kerning = FT_HAS_KERNING(font->face);
+	font->glyph_capacity = 128;
+	font->glyphs = calloc(font->glyph_capacity, sizeof(Text_Glyph));
+	if(!font->glyphs) {
+		ERROR_EXIT("Could not allocate glyphs for %s\n", path);
+	}
+
+	return (ui32)array_list_append(text.fonts, &font);
+}
+
+f32 render_font_line_height(ui32 font) {
+	return (*(Text_Font**)array_list_get(text.fonts, font))->line_height;
+}
+
+// Called once per frame from render_begin.
+void render_text_frame_begin(void) {
+	++text.frame;
+}
+
+// Takes the shelves drawn from since the last call. Geometry kept past
+// this frame holds on to them with render_text_touch.
+void render_text_usage(ui64 used[RENDER_TEXT_USAGE_WORDS]) {
+	memcpy(used, text.used, sizeof(text.used));
+	memset(text.used, 0, sizeof(text.used));
+}
+
+// Starts counting afresh, for geometry about to be built.
+void render_text_usage_reset(void) {
+	memset(text.used, 0, sizeof(text.used));
+}
+
+void render_text_touch(const ui64 used[RENDER_TEXT_USAGE_WORDS]) {
+	for(ui32 i = 0; i < text.shelf_count; ++i) {
+		if(used[i / 64] & (1ull << (i % 64))) {
+			text.shelves[i].last_used = text.frame;
+		}
+	}
+}
+
+// Changes when any glyph may have moved, so UVs taken before are stale
+// unless their shelves were touched every frame since.
+ui32 render_text_generation(void) {
+	return text.generation;
+}
+
+static void use_shelf(ui32 shelf) {
+	text.shelves[shelf].last_used = text.frame;
+	text.used[shelf / 64] |= 1ull << (shelf % 64);
+}
+
+static Text_Glyph *find_glyph(Text_Font *font, ui32 codepoint) {
+	ui32 mask = font->glyph_capacity - 1;
+	ui32 i = (codepoint * 2654435761u) & mask;
+
+	while(font->glyphs[i].is_used && font->glyphs[i].codepoint != codepoint) {
+		i = (i + 1) & mask;
+	}
+
+	return &font->glyphs[i];
+}
+
+static void grow_glyphs(Text_Font *font) {
+	Text_Glyph *old = font->glyphs;
+	ui32 old_capacity = font->glyph_capacity;
+
+	font->glyph_capacity *= 2;
+	font->glyphs = calloc(font->glyph_capacity, sizeof(Text_Glyph));
+	if(!font->glyphs) {
+		ERROR_EXIT("Could not grow glyph table to %u\n", font->glyph_capacity);
+	}
+
+	for(ui32 i = 0; i < old_capacity; ++i) {
+		if(old[i].is_used) {
+			*find_glyph(font, old[i].codepoint) = old[i];
+		}
+	}
+
+	free(old);
+}
+
+// Metrics are read once per glyph and kept even when its pixels are
+// evicted from the atlas.
+static Text_Glyph *get_glyph(Text_Font *font, ui32 codepoint) {
+	Text_Glyph *glyph = find_glyph(font, codepoint);
+	if(glyph->is_used) {
+		return glyph;
+	}
+
+	if((font->glyph_count + 1) * 2 > font->glyph_capacity) {
+		grow_glyphs(font);
+		glyph = find_glyph(font, codepoint);
+	}
+
+	ui32 glyph_index = FT_Get_Char_Index(font->face, codepoint);
+	if(FT_Load_Glyph(font->face, glyph_index, FT_LOAD_DEFAULT)) {
+		glyph_index = 0;
+		FT_Load_Glyph(font->face, 0, FT_LOAD_DEFAULT);
+	}
+
+	*glyph = (Text_Glyph){
+		.codepoint = codepoint,
+		.glyph_index = glyph_index,
+		.advance = (i16)(font->face->glyph->advance.x >> 6),
+		.shelf = TEXT_MAX_SHELVES,
+		.is_used = true
+	};
+	++font->glyph_count;
+
+	return glyph;
+}
+
+static i16 get_kerning(Text_Font *font, ui32 left, ui32 right) {
+	ui64 pair = ((ui64)left << 32) | right;
+	Text_Kerning *entry = &font->kerning[(pair * 0x9E3779B97F4A7C15ull) >> 54];
+
+	if(!entry->is_valid || entry->pair != pair) {
+		FT_Vector delta = {0};
+		FT_Get_Kerning(font->face, left, right, FT_KERNING_DEFAULT, &delta);
+		*entry = (Text_Kerning){.pair = pair, .kerning = (i16)(delta.x >> 6), .is_valid = true};
+	}
+
+	return entry->kerning;
+}
+
+// Runs where GL lives. The payload is the header followed by the glyph's
+// coverage, one byte per pixel.
+static void upload_glyph(const void *payload) {
+	const Glyph_Upload *upload = payload;
+	const ui8 *pixels = (const ui8*)(upload + 1);
+
+	if(text.is_software) {
+		render_soft_texture_write_alpha(text.texture_id, upload->x, upload->y, upload->width, upload->height, pixels);
+		return;
+	}
+
+	render_state_bind_texture(0, text.texture_id);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, upload->x, upload->y, upload->width, upload->height, GL_RED, GL_UNSIGNED_BYTE, pixels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	render_capture_forget_texture(text.texture_id);
+}
+
+// Best fitting shelf with room, then a new shelf, then the least recently
+// used shelf that is tall enough.
+static Text_Shelf *allocate(ui32 width, ui32 height, ui16 *x) {
+	width += TEXT_GLYPH_PADDING;
+	height += TEXT_GLYPH_PADDING;
+
+	Text_Shelf *best = NULL;
+	for(ui32 i = 0; i < text.shelf_count; ++i) {
+		Text_Shelf *shelf = &text.shelves[i];
+		if(shelf->height >= height && shelf->height <= height + height / 2 && shelf->x + width <= TEXT_ATLAS_SIZE) {
+			if(!best || shelf->height < best->height) {
+				best = shelf;
+			}
+		}
+	}
+
+	if(!best && text.shelf_count < TEXT_MAX_SHELVES) {
+		ui32 bottom = 0;
+		if(text.shelf_count > 0) {
+			Text_Shelf *last = &text.shelves[text.shelf_count - 1];
+			bottom = last->y + last->height;
+		}
+
+		ui32 shelf_height = (height + 3) & ~3u;
+		if(bottom + shelf_height <= TEXT_ATLAS_SIZE) {
+			best = &text.shelves[text.shelf_count++];
+			*best = (Text_Shelf){.y = (ui16)bottom, .height = (ui16)shelf_height};
+		}
+	}
+
+	if(!best) {
+		for(ui32 i = 0; i < text.shelf_count; ++i) {
+			Text_Shelf *shelf = &text.shelves[i];
+			if(shelf->height >= height && shelf->last_used + 1 < text.frame && (!best || shelf->last_used < best->last_used)) {
+				best = shelf;
+			}
+		}
+
+		if(!best) {
+			return NULL;
+		}
+
+		best->x = 0;
+		++best->generation;
+		++text.generation;
+	}
+
+	*x = best->x;
+	best->x += (ui16)width;
+
+	return best;
+}
+
+static bool is_resident(const Text_Glyph *glyph) {
+	return glyph->shelf < text.shelf_count && text.shelves[glyph->shelf].generation == glyph->generation;
+}
+
+// Rasterizes the glyph into the atlas unless it is already there. Returns
+// false when the atlas has no room left this frame.
+static bool make_resident(Text_Font *font, Text_Glyph *glyph) {
+	if(glyph->is_empty) {
+		return true;
+	}
+
+	if(is_resident(glyph)) {
+		use_shelf(glyph->shelf);
+		return true;
+	}
+
+	if(FT_Load_Glyph(font->face, glyph->glyph_index, FT_LOAD_RENDER)) {
+		return false;
+	}
+
+	FT_GlyphSlot slot = font->face->glyph;
+	FT_Bitmap *bitmap = &slot->bitmap;
+	glyph->left = (i16)slot->bitmap_left;
+	glyph->top = (i16)slot->bitmap_top;
+	glyph->width = (ui16)bitmap->width;
+	glyph->height = (ui16)bitmap->rows;
+
+	if(glyph->width == 0 || glyph->height == 0) {
+		glyph->is_empty = true;
+		return true;
+	}
+
+	ui16 x;
+	Text_Shelf *shelf = allocate(glyph->width, glyph->height, &x);
+	if(!shelf) {
+		return false;
+	}
+
+	glyph->x = x;
+	glyph->y = shelf->y;
+	glyph->shelf = (ui16)(shelf - text.shelves);
+	glyph->generation = shelf->generation;
+	use_shelf(glyph->shelf);
+
+	usize size = sizeof(Glyph_Upload) + (usize)glyph->width * glyph->height;
+	Glyph_Upload *upload = malloc(size);
+	if(!upload) {
+		ERROR_EXIT("Could not allocate %ux%u glyph\n", glyph->width, glyph->height);
+	}
+
+	*upload = (Glyph_Upload){.x = glyph->x, .y = glyph->y, .width = glyph->width, .height = glyph->height};
+	ui8 *pixels = (ui8*)(upload + 1);
+	for(ui32 row = 0; row < glyph->height; ++row) {
+		memcpy(&pixels[row * glyph->width], &bitmap->buffer[row * bitmap->pitch], glyph->width);
+	}
+
+	render_command_submit(upload_glyph, upload, size);
+	free(upload);
+
+	return true;
+}
+
+static ui32 decode_utf8(const char **text_pointer) {
+	const ui8 *s = (const ui8*)*text_pointer;
+	ui32 codepoint = s[0];
+	ui32 length = 1;
+
+	if(s[0] >= 0xF0 && s[1] && s[2] && s[3]) {
+		codepoint = ((s[0] & 0x07) << 18) | ((s[1] & 0x3F) << 12) | ((s[2] & 0x3F) << 6) | (s[3] & 0x3F);
+		length = 4;
+	} else if(s[0] >= 0xE0 && s[1] && s[2]) {
+		codepoint = ((s[0] & 0x0F) << 12) | ((s[1] & 0x3F) << 6) | (s[2] & 0x3F);
+		length = 3;
+	} else if(s[0] >= 0xC0 && s[1]) {
+		codepoint = ((s[0] & 0x1F) << 6) | (s[1] & 0x3F);
+		length = 2;
+	}
+
+	*text_pointer += length;
+	return codepoint;
+}
+
+// Pen advance of the string, kerning included.
+f32 render_text_width(ui32 font_id, const char *string) {
+	Text_Font *font = *(Text_Font**)array_list_get(text.fonts, font_id);
+	f32 width = 0;
+	ui32 previous = 0;
+
+	while(*string) {
+		Text_Glyph *glyph = get_glyph(font, decode_utf8(&string));
+		if(font->has_kerning && previous) {
+			width += get_kerning(font, previous, glyph->glyph_index);
+		}
+
+		width += glyph->advance;
+		previous = glyph->glyph_index;
+	}
+
+	return width;
+}
+
+// Draws the string with its baseline starting at position. Each glyph is
+// a sprite from the atlas, so a screen of text is part of the batch like
+// everything else. Newlines move down one line height.
+void render_text(ui32 font_id, const char *string, vec2 position, vec4 color) {
+	Text_Font *font = *(Text_Font**)array_list_get(text.fonts, font_id);
+	f32 pen_x = floorf(position[0]);
+	f32 pen_y = floorf(position[1]);
+	ui32 previous = 0;
+
+	text.sprites->len = 0;
+
+	while(*string) {
+		ui32 codepoint = decode_utf8(&string);
+		if(codepoint == '\n') {
+			pen_x = floorf(position[0]);
+			pen_y -= font->line_height;
+			previous = 0;
+			continue;
+		}
+
+		Text_Glyph *glyph = get_glyph(font, codepoint);
+		if(font->has_kerning && previous) {
+			pen_x += get_kerning(font, previous, glyph->glyph_index);
+		}
+		previous = glyph->glyph_index;
+
+		if(make_resident(font, glyph) && glyph->width > 0 && glyph->height > 0) {
+			f32 x0 = pen_x + glyph->left;
+			f32 y1 = pen_y + glyph->top;
+
+			// Bitmap rows run top down, so the bottom edge takes the
+			// larger v.
+			Sprite_Instance *sprite = array_list_append_n(text.sprites, 1);
+			*sprite = (Sprite_Instance){
+				.position = {x0 + glyph->width * 0.5f, y1 - glyph->height * 0.5f},
+				.size = {glyph->width, glyph->height},
+				.uvs = {
+					(f32)glyph->x / TEXT_ATLAS_SIZE,
+					(f32)(glyph->y + glyph->height) / TEXT_ATLAS_SIZE,
+					(f32)(glyph->x + glyph->width) / TEXT_ATLAS_SIZE,
+					(f32)glyph->y / TEXT_ATLAS_SIZE
+				},
+				.color = {color[0], color[1], color[2], color[3]},
+				.texture_id = text.texture_id
+			};
+		}
+
+		pen_x += glyph->advance;
+	}
+
+	if(text.sprites->len > 0) {
+		render_sprites(text.sprites->items, text.sprites->len);
+	}
+}
\ No newline at end of file
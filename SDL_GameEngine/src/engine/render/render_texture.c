@@ -0,0 +1,231 @@
+#include <glad/glad.h>
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../util.h"
+#include "../render.h"
+#include "../array_list.h"
+#include "render_internal.h"
+
+#define MAX_DECODE_THREADS 4
+
+// Bytes uploaded per frame before the rest wait for the next one. At
+// least one image goes up each frame, however large.
+#define TEXTURE_UPLOAD_BUDGET (4 * 1024 * 1024)
+
+typedef struct texture_request {
+	Sprite_Sheet *target;
+	// Dimensions known up front; the decode thread fills in the cells.
+	Sprite_Sheet sheet;
+	Render_Image image;
+	char path[256];
+	// Set by the decoder when the image could not be loaded, to be
+	// reported where it was requested.
+	bool is_failed;
+} Texture_Request;
+
+typedef struct texture_upload {
+	ui32 texture_id;
+	Render_Image image;
+} Texture_Upload;
+
+typedef struct texture_loader {
+	SDL_Thread *threads[MAX_DECODE_THREADS];
+	ui32 thread_count;
+	SDL_mutex *mutex;
+	SDL_cond *work_ready;
+	Array_List *queued;
+	Array_List *decoded;
+	ui32 pending;
+	ui32 pbos[2];
+	ui32 pbo_index;
+	bool is_quitting;
+} Texture_Loader;
+
+static Texture_Loader loader;
+
+static int decode_main(void *data) {
+	(void)data;
+
+	for(;;) {
+		SDL_LockMutex(loader.mutex);
+		while(loader.queued->len == 0 && !loader.is_quitting) {
+			SDL_CondWait(loader.work_ready, loader.mutex);
+		}
+
+		if(loader.is_quitting) {
+			SDL_UnlockMutex(loader.mutex);
+			return 0;
+		}
+
+		Texture_Request request = *(Texture_Request*)array_list_get(loader.queued, --loader.queued->len);
+		SDL_UnlockMutex(loader.mutex);
+
+		Render_Image *image = &request.image;
+		if(!render_image_load(image, request.path)) {
+			request.is_failed = true;
+		} else if((f32)image->width != request.sheet.width || (f32)image->height != request.sheet.height) {
+			render_image_free(image);
+			request.is_failed = true;
+		} else {
+			render_sprite_sheet_analyze(&request.sheet, image->pixels);
+		}
+
+		SDL_LockMutex(loader.mutex);
+		array_list_append(loader.decoded, &request);
+		SDL_UnlockMutex(loader.mutex);
+	}
+}
+
+static void init(void) {
+	loader.mutex = SDL_CreateMutex();
+	loader.work_ready = SDL_CreateCond();
+	loader.queued = array_list_create(sizeof(Texture_Request), 0);
+	loader.decoded = array_list_create(sizeof(Texture_Request), 0);
+	if(!loader.mutex || !loader.work_ready || !loader.queued || !loader.decoded) {
+		ERROR_EXIT("Could not create texture loader: %s\n", SDL_GetError());
+	}
+
+	i32 cpu_count = SDL_GetCPUCount();
+	loader.thread_count = cpu_count > 2 ? cpu_count - 1 : 1;
+	if(loader.thread_count > MAX_DECODE_THREADS) {
+		loader.thread_count = MAX_DECODE_THREADS;
+	}
+
+	// Decoders sleep when idle until render_texture_shutdown.
+	for(ui32 i = 0; i < loader.thread_count; ++i) {
+		loader.threads[i] = SDL_CreateThread(decode_main, "texture_decode", NULL);
+		if(!loader.threads[i]) {
+			ERROR_EXIT("Could not create texture decode thread: %s\n", SDL_GetError());
+		}
+	}
+}
+
+// Images still queued are left undecoded.
+void render_texture_shutdown(void) {
+	if(!loader.mutex) {
+		return;
+	}
+
+	SDL_LockMutex(loader.mutex);
+	loader.is_quitting = true;
+	SDL_CondBroadcast(loader.work_ready);
+	SDL_UnlockMutex(loader.mutex);
+
+	for(ui32 i = 0; i < loader.thread_count; ++i) {
+		SDL_WaitThread(loader.threads[i], NULL);
+	}
+
+	loader.thread_count = 0;
+}
+
+// Queues the sheet's image for decoding on the loader threads.
+void render_texture_load(Sprite_Sheet *sprite_sheet, const char *path) {
+	if(!loader.mutex) {
+		init();
+	}
+
+	Texture_Request request = {
+		.target = sprite_sheet,
+		.sheet = *sprite_sheet
+	};
+	snprintf(request.path, sizeof(request.path), "%s", path);
+
+	SDL_LockMutex(loader.mutex);
+	array_list_append(loader.queued, &request);
+	++loader.pending;
+	SDL_CondSignal(loader.work_ready);
+	SDL_UnlockMutex(loader.mutex);
+}
+
+// Runs where GL lives. The pixels go through a pixel buffer object, so
+// glTexImage2D returns without waiting for the driver to copy them.
+static void upload_texture(const void *payload) {
+	const Texture_Upload *upload = payload;
+	Render_Image image = upload->image;
+	usize size = (usize)image.width * image.height * 4;
+
+	if(!loader.pbos[0]) {
+		glGenBuffers(2, loader.pbos);
+	}
+
+	ui32 pbo = loader.pbos[loader.pbo_index];
+	loader.pbo_index ^= 1;
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+
+	void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	const void *source = NULL;
+	if(mapped) {
+		memcpy(mapped, image.pixels, size);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	} else {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		source = image.pixels;
+	}
+
+	render_state_bind_texture(0, upload->texture_id);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, source);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	render_capture_forget_texture(upload->texture_id);
+	render_image_free(&image);
+}
+
+// Called once per frame from render_begin. Hands decoded images to the GL
+// side up to the upload budget and swaps in their cell data.
+void render_texture_uploads(void) {
+	if(!loader.mutex) {
+		return;
+	}
+
+	usize uploaded = 0;
+
+	SDL_LockMutex(loader.mutex);
+	while(loader.decoded->len > 0 && uploaded < TEXTURE_UPLOAD_BUDGET) {
+		Texture_Request request = *(Texture_Request*)array_list_get(loader.decoded, --loader.decoded->len);
+		--loader.pending;
+		SDL_UnlockMutex(loader.mutex);
+
+		// The sheet keeps its placeholder and draws nothing.
+		if(request.is_failed) {
+			fprintf(stderr, "Failed to load image: %s\n", request.path);
+			SDL_LockMutex(loader.mutex);
+			continue;
+		}
+
+		Texture_Upload upload = {
+			.texture_id = request.target->texture_id,
+			.image = request.image
+		};
+
+		render_command_submit(upload_texture, &upload, sizeof(upload));
+
+		free(request.target->cells);
+		request.target->cells = request.sheet.cells;
+		request.target->is_premultiplied = request.image.is_premultiplied;
+
+		uploaded += (usize)request.image.width * request.image.height * 4;
+		SDL_LockMutex(loader.mutex);
+	}
+	SDL_UnlockMutex(loader.mutex);
+
+	// The static layer may have been built with a placeholder.
+	if(uploaded > 0) {
+		render_static_invalidate();
+	}
+}
+
+ui32 render_texture_pending(void) {
+	if(!loader.mutex) {
+		return 0;
+	}
+
+	SDL_LockMutex(loader.mutex);
+	ui32 pending = loader.pending;
+	SDL_UnlockMutex(loader.mutex);
+
+	return pending;
+}
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include <glad/glad.h>
+#include <SDL2/SDL.h>
+
+#include "../util.h"
+#include "../render.h"
+#include "render_internal.h"
+
+typedef struct render_thread {
+	SDL_Thread *thread;
+	SDL_mutex *mutex;
+	SDL_cond *frame_ready;
+	SDL_cond *frame_done;
+	SDL_Window *window;
+	SDL_GLContext context;
+	Render_Frame *pending;
+	bool is_busy;
+	bool is_running;
+	bool is_quitting;
+} Render_Thread;
+
+typedef struct render_command {
+	Render_Command_Function function;
+	usize size;
+} Render_Command;
+
+static Render_Thread render_thread;
+
+static int render_thread_main(void *data) {
+	(void)data;
+
+	// The software backend has no context to move.
+	if(render_thread.context && SDL_GL_MakeCurrent(render_thread.window, render_thread.context) != 0) {
+		ERROR_EXIT("Could not make GL context current on render thread: %s\n", SDL_GetError());
+	}
+
+	for(;;) {
+		SDL_LockMutex(render_thread.mutex);
+		while(!render_thread.pending && !render_thread.is_quitting) {
+			SDL_CondWait(render_thread.frame_ready, render_thread.mutex);
+		}
+
+		Render_Frame *frame = render_thread.pending;
+		SDL_UnlockMutex(render_thread.mutex);
+
+		if(!frame) {
+			break;
+		}
+
+		render_frame_draw(frame);
+		render_present(render_thread.window);
+
+		SDL_LockMutex(render_thread.mutex);
+		render_thread.pending = NULL;
+		render_thread.is_busy = false;
+		SDL_CondSignal(render_thread.frame_done);
+		SDL_UnlockMutex(render_thread.mutex);
+	}
+
+	if(render_thread.context) {
+		SDL_GL_MakeCurrent(render_thread.window, NULL);
+	}
+
+	return 0;
+}
+
+// Hands the GL context to a dedicated thread. From here on render_end only
+// passes the finished frame over and returns, so the next frame is
+// simulated while this one is drawn, one frame behind. Textures and other
+// GL resources have to be created before the thread is started.
+void render_thread_start(SDL_Window *window) {
+	render_thread.mutex = SDL_CreateMutex();
+	render_thread.frame_ready = SDL_CreateCond();
+	render_thread.frame_done = SDL_CreateCond();
+	if(!render_thread.mutex || !render_thread.frame_ready || !render_thread.frame_done) {
+		ERROR_EXIT("Could not create render thread sync objects: %s\n", SDL_GetError());
+	}
+
+	render_thread.window = window;
+	render_thread.context = SDL_GL_GetCurrentContext();
+	if(render_thread.context) {
+		SDL_GL_MakeCurrent(window, NULL);
+	}
+
+	render_thread.is_running = true;
+	render_thread.thread = SDL_CreateThread(render_thread_main, "render", NULL);
+	if(!render_thread.thread) {
+		ERROR_EXIT("Could not create render thread: %s\n", SDL_GetError());
+	}
+}
+
+void render_thread_stop(void) {
+	if(!render_thread.is_running) {
+		return;
+	}
+
+	SDL_LockMutex(render_thread.mutex);
+	render_thread.is_quitting = true;
+	SDL_CondSignal(render_thread.frame_ready);
+	SDL_UnlockMutex(render_thread.mutex);
+
+	SDL_WaitThread(render_thread.thread, NULL);
+	if(render_thread.context) {
+		SDL_GL_MakeCurrent(render_thread.window, render_thread.context);
+	}
+	render_thread.is_running = false;
+}
+
+bool render_thread_is_running(void) {
+	return render_thread.is_running;
+}
+
+// Waits for the previous frame to finish drawing, then queues this one.
+void render_thread_submit(Render_Frame *frame) {
+	SDL_LockMutex(render_thread.mutex);
+	while(render_thread.is_busy) {
+		SDL_CondWait(render_thread.frame_done, render_thread.mutex);
+	}
+
+	render_thread.pending = frame;
+	render_thread.is_busy = true;
+	SDL_CondSignal(render_thread.frame_ready);
+	SDL_UnlockMutex(render_thread.mutex);
+}
+
+// Commands are stored inline as a header followed by a copy of the payload,
+// padded so the next header stays aligned.
+void render_command_push(Array_List *commands, Render_Command_Function function, const void *payload, usize size) {
+	usize padded = (size + 15) & ~(usize)15;
+	Render_Command *command = array_list_append_n(commands, sizeof(Render_Command) + padded);
+	if(!command) {
+		ERROR_EXIT("Could not append render command\n");
+	}
+
+	command->function = function;
+	command->size = padded;
+	memcpy(command + 1, payload, size);
+}
+
+void render_command_execute(Array_List *commands) {
+	ui8 *cursor = commands->items;
+	ui8 *end = cursor + commands->len;
+
+	while(cursor < end) {
+		Render_Command *command = (Render_Command*)cursor;
+		command->function(command + 1);
+		cursor += sizeof(Render_Command) + command->size;
+	}
+}
\ No newline at end of file
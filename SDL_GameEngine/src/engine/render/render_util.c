@@ -1,27 +1,45 @@
 #include <glad/glad.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "../util.h"
 #include "../io.h"
 #include "render_internal.h"
 
-ui32 render_shader_create(const char *path_vert, const char *path_frag) {
+// Compiles source with defines inserted after its #version line, which
+// has to come first.
+static ui32 compile_shader(GLenum type, const char *source, const char *defines, const char *path) {
 	int success;
 	char log[512];
 
-	File file_vertex = io_file_read(path_vert);
-	if(!file_vertex.is_valid) {;
-		ERROR_EXIT("Error reading shader: %s\n", path_vert);
-	}
+	const char *body = strchr(source, '\n');
+	body = body ? body + 1 : source + strlen(source);
+
+	const char *strings[3] = {source, defines, body};
+	GLint lengths[3] = {(GLint)(body - source), -1, -1};
 
-	ui32 shader_vertex = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(shader_vertex, 1, (const char *const *)&file_vertex, NULL);
-	glCompileShader(shader_vertex);
-	glGetShaderiv(shader_vertex, GL_COMPILE_STATUS, &success);
+	ui32 shader = glCreateShader(type);
+	glShaderSource(shader, 3, strings, lengths);
+	glCompileShader(shader);
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
 
 	if(!success) {
-		glGetShaderInfoLog(shader_vertex, 512, NULL, log);
-		ERROR_EXIT("Error compiling vertex shader: %s\n", log);
+		glGetShaderInfoLog(shader, 512, NULL, log);
+		ERROR_EXIT("Error compiling shader %s: %s\n", path, log);
+	}
+
+	return shader;
+}
+
+// Builds one variant of a shader pair. defines holds "#define X\n" lines
+// and is part of the cache key, so each variant is cached separately.
+ui32 render_shader_create_variant(const char *path_vert, const char *path_frag, const char *defines) {
+	int success;
+	char log[512];
+
+	File file_vertex = io_file_read(path_vert);
+	if(!file_vertex.is_valid) {;
+		ERROR_EXIT("Error reading shader: %s\n", path_vert);
 	}
 
 	File file_fragment = io_file_read(path_frag);
@@ -29,19 +47,27 @@ ui32 render_shader_create(const char *path_vert, const char *path_frag) {
 		ERROR_EXIT("Error reading shader: %s\n", path_frag);
 	}
 
-	ui32 shader_fragment = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(shader_fragment, 1, (const char *const *)&file_fragment, NULL);
-	glCompileShader(shader_fragment);
-	glGetShaderiv(shader_fragment, GL_COMPILE_STATUS, &success);
+	char name[1024];
+	snprintf(name, sizeof(name), "%s|%s|%s", path_vert, path_frag, defines);
+	const char *sources[3] = {file_vertex.data, file_fragment.data, defines};
+	ui64 key = render_shader_cache_key(sources, 3);
 
-	if(!success) {
-		glGetShaderInfoLog(shader_fragment, 512, NULL, log);
-		ERROR_EXIT("Error compiling fragment shader: %s\n", log);
+	ui32 shader = glCreateProgram();
+	if(render_shader_cache_load(shader, name, key)) {
+		render_state_program_register(shader);
+
+		free(file_vertex.data);
+		free(file_fragment.data);
+
+		return shader;
 	}
 
-	ui32 shader = glCreateProgram();
+	ui32 shader_vertex = compile_shader(GL_VERTEX_SHADER, file_vertex.data, defines, path_vert);
+	ui32 shader_fragment = compile_shader(GL_FRAGMENT_SHADER, file_fragment.data, defines, path_frag);
+
 	glAttachShader(shader, shader_vertex);
 	glAttachShader(shader, shader_fragment);
+	render_shader_cache_prepare(shader);
 	glLinkProgram(shader);
 	glGetProgramiv(shader, GL_LINK_STATUS, &success);
 	if(!success) {
@@ -49,12 +75,25 @@ ui32 render_shader_create(const char *path_vert, const char *path_frag) {
 		ERROR_EXIT("Error linking shader: %s\n", log);
 	}
 
+	glDetachShader(shader, shader_vertex);
+	glDetachShader(shader, shader_fragment);
+	glDeleteShader(shader_vertex);
+	glDeleteShader(shader_fragment);
+
+	render_shader_cache_store(shader, name, key);
+
+	render_state_program_register(shader);
+
 	free(file_vertex.data);
 	free(file_fragment.data);
 
 	return shader;
 }
 
+ui32 render_shader_create(const char *path_vert, const char *path_frag) {
+	return render_shader_create_variant(path_vert, path_frag, "");
+}
+
 
 
 
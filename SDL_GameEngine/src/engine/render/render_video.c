@@ -0,0 +1,372 @@
+#include <glad/glad.h>
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../util.h"
+#include "../io.h"
+#include "../render.h"
+#include "render_internal.h"
+
+// Frames are read back into this many pixel buffer objects in turn, and
+// each is mapped when its turn comes round again. By then the copy has
+// long finished, so neither the read nor the map waits on the GPU.
+#define VIDEO_PBO_COUNT 3
+
+// Frames waiting for the encoder. When it falls this far behind, new
+// frames are dropped rather than stalling the frame.
+#define VIDEO_QUEUE_SIZE 6
+
+typedef struct render_video {
+	// Set on the submitting side.
+	char path[256];
+	Render_Video_Format format;
+	ui32 frame_rate;
+	bool is_requested;
+
+	// Owned where GL lives.
+	bool is_active;
+	bool uses_pbos;
+	ui32 width;
+	ui32 height;
+	ui32 pbos[VIDEO_PBO_COUNT];
+	bool is_read[VIDEO_PBO_COUNT];
+	ui32 pbo_index;
+	ui32 frames_dropped;
+
+	// Shared with the encoder thread.
+	SDL_Thread *thread;
+	SDL_mutex *mutex;
+	SDL_cond *frame_ready;
+	SDL_cond *frame_done;
+	ui8 *frames[VIDEO_QUEUE_SIZE];
+	ui32 head;
+	ui32 count;
+	bool is_finishing;
+
+	// Owned by the encoder thread.
+	FILE *file;
+	ui8 *planes;
+	ui8 *row;
+	ui32 frames_written;
+} Render_Video;
+
+static Render_Video video;
+
+// Records every frame from the next one on into path, until
+// render_video_end, at the scene's resolution before upscaling. Raw files are RGBA frames back to back, top row
+// first. PNG frames are written as path_00000.png and on, with any
+// extension of path left out. Y4M streams are 4:4:4 at frame_rate, which
+// most encoders take as input.
+void render_video_begin(const char *path, Render_Video_Format format, ui32 frame_rate) {
+	snprintf(video.path, sizeof(video.path), "%s", path);
+
+	if(format == RENDER_VIDEO_PNG) {
+		char *dot = strrchr(video.path, '.');
+		if(dot && dot != video.path && !strpbrk(dot, "/\\")) {
+			*dot = 0;
+		}
+	}
+	video.format = format;
+	video.frame_rate = frame_rate;
+	video.is_requested = true;
+}
+
+static void finish(void);
+
+// Stops recording. Frames already read back are still written. With the
+// render thread running the file is closed once the next frame is drawn,
+// so at exit call this after render_thread_stop.
+void render_video_end(void) {
+	video.is_requested = false;
+
+	if(!render_thread_is_running() && video.is_active) {
+		finish();
+	}
+}
+
+bool render_video_next(void) {
+	return video.is_requested;
+}
+
+// BT.601 studio range.
+static void write_y4m(const ui8 *pixels) {
+	usize pixel_count = (usize)video.width * video.height;
+	ui8 *y_plane = video.planes;
+	ui8 *u_plane = y_plane + pixel_count;
+	ui8 *v_plane = u_plane + pixel_count;
+
+	for(usize i = 0; i < pixel_count; ++i) {
+		i32 r = pixels[i * 4 + 0];
+		i32 g = pixels[i * 4 + 1];
+		i32 b = pixels[i * 4 + 2];
+
+		y_plane[i] = (ui8)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+		u_plane[i] = (ui8)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+		v_plane[i] = (ui8)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+	}
+
+	fputs("FRAME\n", video.file);
+	fwrite(video.planes, pixel_count * 3, 1, video.file);
+}
+
+// Frames read back from GL are queued bottom row first, as they come,
+// and turned over here rather than on the thread that draws.
+static void flip(ui8 *pixels) {
+	usize row_size = (usize)video.width * 4;
+
+	for(ui32 y = 0; y < video.height / 2; ++y) {
+		ui8 *top = &pixels[y * row_size];
+		ui8 *bottom = &pixels[(video.height - 1 - y) * row_size];
+
+		memcpy(video.row, top, row_size);
+		memcpy(top, bottom, row_size);
+		memcpy(bottom, video.row, row_size);
+	}
+}
+
+static void encode(const ui8 *pixels) {
+	switch(video.format) {
+		case RENDER_VIDEO_RAW: {
+			fwrite(pixels, (usize)video.width * video.height * 4, 1, video.file);
+		} break;
+		case RENDER_VIDEO_PNG: {
+			char path[300];
+			snprintf(path, sizeof(path), "%s_%05u.png", video.path, video.frames_written);
+			io_png_write(path, pixels, video.width, video.height);
+		} break;
+		case RENDER_VIDEO_Y4M: {
+			write_y4m(pixels);
+		} break;
+	}
+
+	++video.frames_written;
+}
+
+static int encode_main(void *data) {
+	(void)data;
+
+	for(;;) {
+		SDL_LockMutex(video.mutex);
+		while(video.count == 0 && !video.is_finishing) {
+			SDL_CondWait(video.frame_ready, video.mutex);
+		}
+
+		if(video.count == 0) {
+			SDL_UnlockMutex(video.mutex);
+			return 0;
+		}
+
+		ui8 *pixels = video.frames[video.head];
+		SDL_UnlockMutex(video.mutex);
+
+		if(video.uses_pbos) {
+			flip(pixels);
+		}
+		encode(pixels);
+
+		SDL_LockMutex(video.mutex);
+		video.head = (video.head + 1) % VIDEO_QUEUE_SIZE;
+		--video.count;
+		SDL_CondSignal(video.frame_done);
+		SDL_UnlockMutex(video.mutex);
+	}
+}
+
+static void start(ui32 width, ui32 height, bool uses_pbos) {
+	usize frame_size = (usize)width * height * 4;
+
+	video.width = width;
+	video.height = height;
+	video.uses_pbos = uses_pbos;
+	video.frames_dropped = 0;
+	video.frames_written = 0;
+	video.head = 0;
+	video.count = 0;
+	video.is_finishing = false;
+
+	if(video.format == RENDER_VIDEO_PNG) {
+		video.file = NULL;
+	} else {
+		video.file = fopen(video.path, "wb");
+		if(!video.file) {
+			ERROR_EXIT("Could not open %s for recording\n", video.path);
+		}
+	}
+
+	if(video.format == RENDER_VIDEO_Y4M) {
+		fprintf(video.file, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C444\n", width, height, video.frame_rate);
+		video.planes = malloc((usize)width * height * 3);
+		if(!video.planes) {
+			ERROR_EXIT("Could not allocate %ux%u video planes\n", width, height);
+		}
+	}
+
+	video.row = malloc((usize)width * 4);
+	if(!video.row) {
+		ERROR_EXIT("Could not allocate %ux%u video row\n", width, height);
+	}
+
+	for(ui32 i = 0; i < VIDEO_QUEUE_SIZE; ++i) {
+		video.frames[i] = malloc(frame_size);
+		if(!video.frames[i]) {
+			ERROR_EXIT("Could not allocate %ux%u video frame\n", width, height);
+		}
+	}
+
+	if(uses_pbos) {
+		glGenBuffers(VIDEO_PBO_COUNT, video.pbos);
+		for(ui32 i = 0; i < VIDEO_PBO_COUNT; ++i) {
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, video.pbos[i]);
+			glBufferData(GL_PIXEL_PACK_BUFFER, frame_size, NULL, GL_STREAM_READ);
+			video.is_read[i] = false;
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		video.pbo_index = 0;
+	}
+
+	video.mutex = SDL_CreateMutex();
+	video.frame_ready = SDL_CreateCond();
+	video.frame_done = SDL_CreateCond();
+	if(!video.mutex || !video.frame_ready || !video.frame_done) {
+		ERROR_EXIT("Could not create video encoder sync objects: %s\n", SDL_GetError());
+	}
+
+	video.thread = SDL_CreateThread(encode_main, "video_encode", NULL);
+	if(!video.thread) {
+		ERROR_EXIT("Could not create video encoder thread: %s\n", SDL_GetError());
+	}
+
+	video.is_active = true;
+}
+
+// Copies a frame into the queue as it is, in one go.
+static void queue_frame(const ui8 *pixels, bool should_wait) {
+	SDL_LockMutex(video.mutex);
+	while(should_wait && video.count == VIDEO_QUEUE_SIZE) {
+		SDL_CondWait(video.frame_done, video.mutex);
+	}
+
+	if(video.count == VIDEO_QUEUE_SIZE) {
+		SDL_UnlockMutex(video.mutex);
+		++video.frames_dropped;
+		return;
+	}
+
+	ui8 *frame = video.frames[(video.head + video.count) % VIDEO_QUEUE_SIZE];
+	SDL_UnlockMutex(video.mutex);
+
+	memcpy(frame, pixels, (usize)video.width * video.height * 4);
+
+	SDL_LockMutex(video.mutex);
+	++video.count;
+	SDL_CondSignal(video.frame_ready);
+	SDL_UnlockMutex(video.mutex);
+}
+
+static void queue_pbo(ui32 index, bool should_wait) {
+	if(!video.is_read[index]) {
+		return;
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, video.pbos[index]);
+	const ui8 *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (usize)video.width * video.height * 4, GL_MAP_READ_BIT);
+	if(pixels) {
+		queue_frame(pixels, should_wait);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	} else {
+		++video.frames_dropped;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	video.is_read[index] = false;
+}
+
+// Queues what is still in flight, then waits for the encoder to write it.
+static void finish(void) {
+	if(video.uses_pbos) {
+		for(ui32 i = 0; i < VIDEO_PBO_COUNT; ++i) {
+			queue_pbo((video.pbo_index + i) % VIDEO_PBO_COUNT, true);
+		}
+		glDeleteBuffers(VIDEO_PBO_COUNT, video.pbos);
+	}
+
+	SDL_LockMutex(video.mutex);
+	video.is_finishing = true;
+	SDL_CondSignal(video.frame_ready);
+	SDL_UnlockMutex(video.mutex);
+
+	SDL_WaitThread(video.thread, NULL);
+	SDL_DestroyCond(video.frame_done);
+	SDL_DestroyCond(video.frame_ready);
+	SDL_DestroyMutex(video.mutex);
+
+	if(video.file) {
+		fclose(video.file);
+	}
+
+	for(ui32 i = 0; i < VIDEO_QUEUE_SIZE; ++i) {
+		free(video.frames[i]);
+	}
+	free(video.planes);
+	free(video.row);
+	video.planes = NULL;
+	video.row = NULL;
+
+	printf("Recorded %u %ux%u frames to %s, dropped %u\n", video.frames_written, video.width, video.height, video.path, video.frames_dropped);
+	video.is_active = false;
+}
+
+// Runs where GL lives, with the scene target bound for reading, so frames
+// are recorded at the scene's resolution rather than upscaled.
+// Reads it into the next buffer of the ring, and first hands that
+// buffer's previous frame to the encoder.
+void render_video_frame(bool is_recorded, ui32 width, ui32 height) {
+	if(is_recorded && !video.is_active) {
+		start(width, height, true);
+	}
+
+	if(!video.is_active) {
+		return;
+	}
+
+	if(!is_recorded) {
+		finish();
+		return;
+	}
+
+	ui32 index = video.pbo_index;
+	video.pbo_index = (index + 1) % VIDEO_PBO_COUNT;
+	queue_pbo(index, false);
+
+	// Frames of another size, from a resized window, are left out.
+	if(width != video.width || height != video.height) {
+		++video.frames_dropped;
+		return;
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, video.pbos[index]);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	video.is_read[index] = true;
+}
+
+// The software backend's pixels are already in memory, top row first.
+void render_video_pixels(bool is_recorded, const ui8 *pixels, ui32 width, ui32 height) {
+	if(is_recorded && !video.is_active) {
+		start(width, height, false);
+	}
+
+	if(!video.is_active) {
+		return;
+	}
+
+	if(!is_recorded) {
+		finish();
+		return;
+	}
+
+	queue_frame(pixels, false);
+}
\ No newline at end of file
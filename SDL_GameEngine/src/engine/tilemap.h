@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdbool.h>
+#include <linmath.h>
+#include "types.h"
+#include "render.h"
+
+#define TILEMAP_CHUNK_SIZE 32
+#define TILEMAP_EMPTY 0
+
+typedef struct tilemap_chunk {
+	Render_Mesh mesh;
+	bool is_dirty;
+} Tilemap_Chunk;
+
+// Tiles are sprite sheet cells numbered row by row from 1; 0 is empty.
+typedef struct tilemap {
+	Sprite_Sheet *sprite_sheet;
+	vec2 origin;
+	ui32 width;
+	ui32 height;
+	ui32 chunk_columns;
+	ui32 chunk_rows;
+	ui16 *tiles;
+	Tilemap_Chunk *chunks;
+} Tilemap;
+
+void tilemap_init(Tilemap *tilemap, Sprite_Sheet *sprite_sheet, ui32 width, ui32 height, vec2 origin);
+void tilemap_destroy(Tilemap *tilemap);
+void tilemap_set(Tilemap *tilemap, ui32 x, ui32 y, ui16 tile);
+ui16 tilemap_get(Tilemap *tilemap, ui32 x, ui32 y);
+void tilemap_render(Tilemap *tilemap);
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include <stdlib.h>
+#include <math.h>
+
+#include "../util.h"
+#include "../camera.h"
+#include "../tilemap.h"
+
+static Sprite_Instance chunk_sprites[TILEMAP_CHUNK_SIZE * TILEMAP_CHUNK_SIZE];
+
+void tilemap_init(Tilemap *tilemap, Sprite_Sheet *sprite_sheet, ui32 width, ui32 height, vec2 origin) {
+	*tilemap = (Tilemap){
+		.sprite_sheet = sprite_sheet,
+		.origin = {origin[0], origin[1]},
+		.width = width,
+		.height = height,
+		.chunk_columns = (width + TILEMAP_CHUNK_SIZE - 1) / TILEMAP_CHUNK_SIZE,
+		.chunk_rows = (height + TILEMAP_CHUNK_SIZE - 1) / TILEMAP_CHUNK_SIZE
+	};
+
+	tilemap->tiles = calloc((usize)width * height, sizeof(ui16));
+	tilemap->chunks = calloc((usize)tilemap->chunk_columns * tilemap->chunk_rows, sizeof(Tilemap_Chunk));
+	if(!tilemap->tiles || !tilemap->chunks) {
+		ERROR_EXIT("Could not allocate %ux%u tilemap\n", width, height);
+	}
+}
+
+void tilemap_destroy(Tilemap *tilemap) {
+	for(ui32 i = 0; i < tilemap->chunk_columns * tilemap->chunk_rows; ++i) {
+		render_mesh_destroy(&tilemap->chunks[i].mesh);
+	}
+
+	free(tilemap->tiles);
+	free(tilemap->chunks);
+	*tilemap = (Tilemap){0};
+}
+
+void tilemap_set(Tilemap *tilemap, ui32 x, ui32 y, ui16 tile) {
+	if(x >= tilemap->width || y >= tilemap->height) {
+		return;
+	}
+
+	ui16 *current = &tilemap->tiles[y * tilemap->width + x];
+	if(*current == tile) {
+		return;
+	}
+
+	*current = tile;
+	tilemap->chunks[(y / TILEMAP_CHUNK_SIZE) * tilemap->chunk_columns + x / TILEMAP_CHUNK_SIZE].is_dirty = true;
+}
+
+ui16 tilemap_get(Tilemap *tilemap, ui32 x, ui32 y) {
+	if(x >= tilemap->width || y >= tilemap->height) {
+		return TILEMAP_EMPTY;
+	}
+
+	return tilemap->tiles[y * tilemap->width + x];
+}
+
+static void build_chunk(Tilemap *tilemap, ui32 chunk_x, ui32 chunk_y) {
+	Sprite_Sheet *sheet = tilemap->sprite_sheet;
+	f32 cell_u = sheet->cell_width / sheet->width;
+	f32 cell_v = sheet->cell_height / sheet->height;
+	ui32 cell_count = sheet->row_count * sheet->column_count;
+	ui32 x0 = chunk_x * TILEMAP_CHUNK_SIZE;
+	ui32 y0 = chunk_y * TILEMAP_CHUNK_SIZE;
+	ui32 x1 = x0 + TILEMAP_CHUNK_SIZE < tilemap->width ? x0 + TILEMAP_CHUNK_SIZE : tilemap->width;
+	ui32 y1 = y0 + TILEMAP_CHUNK_SIZE < tilemap->height ? y0 + TILEMAP_CHUNK_SIZE : tilemap->height;
+	usize count = 0;
+
+	for(ui32 y = y0; y < y1; ++y) {
+		for(ui32 x = x0; x < x1; ++x) {
+			ui16 tile = tilemap->tiles[y * tilemap->width + x];
+			if(tile == TILEMAP_EMPTY || tile > cell_count) {
+				continue;
+			}
+
+			ui32 row = (tile - 1) / sheet->column_count;
+			ui32 column = (tile - 1) % sheet->column_count;
+
+			chunk_sprites[count++] = (Sprite_Instance){
+				.position = {
+					tilemap->origin[0] + (x + 0.5) * sheet->cell_width,
+					tilemap->origin[1] + (y + 0.5) * sheet->cell_height
+				},
+				.size = {sheet->cell_width, sheet->cell_height},
+				.uvs = {column * cell_u, row * cell_v, (column + 1) * cell_u, (row + 1) * cell_v},
+				.color = {1, 1, 1, 1},
+				.texture_id = sheet->texture_id
+			};
+		}
+	}
+
+	Tilemap_Chunk *chunk = &tilemap->chunks[chunk_y * tilemap->chunk_columns + chunk_x];
+	render_mesh_upload(&chunk->mesh, chunk_sprites, count);
+	chunk->is_dirty = false;
+}
+
+static ui32 clamp_chunk(f32 value, ui32 count) {
+	if(value < 0) {
+		return 0;
+	}
+
+	return value < count ? (ui32)value : count;
+}
+
+// Only chunks touching the camera are rebuilt or drawn, so edits to
+// off-screen chunks cost nothing until they scroll into view.
+void tilemap_render(Tilemap *tilemap) {
+	vec4 view;
+	camera_view_rect(view);
+
+	f32 chunk_width = TILEMAP_CHUNK_SIZE * tilemap->sprite_sheet->cell_width;
+	f32 chunk_height = TILEMAP_CHUNK_SIZE * tilemap->sprite_sheet->cell_height;
+	ui32 x0 = clamp_chunk(floorf((view[0] - tilemap->origin[0]) / chunk_width), tilemap->chunk_columns);
+	ui32 y0 = clamp_chunk(floorf((view[1] - tilemap->origin[1]) / chunk_height), tilemap->chunk_rows);
+	ui32 x1 = clamp_chunk(floorf((view[2] - tilemap->origin[0]) / chunk_width) + 1, tilemap->chunk_columns);
+	ui32 y1 = clamp_chunk(floorf((view[3] - tilemap->origin[1]) / chunk_height) + 1, tilemap->chunk_rows);
+
+	for(ui32 y = y0; y < y1; ++y) {
+		for(ui32 x = x0; x < x1; ++x) {
+			Tilemap_Chunk *chunk = &tilemap->chunks[y * tilemap->chunk_columns + x];
+
+			if(chunk->is_dirty) {
+				build_chunk(tilemap, x, y);
+			}
+
+			render_mesh(&chunk->mesh, tilemap->sprite_sheet->texture_id);
+		}
+	}
+}
\ No newline at end of file
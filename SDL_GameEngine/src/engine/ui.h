@@ -0,0 +1,11 @@
+#pragma once
+
+#include "render.h"
+
+void ui_init(void);
+void ui_begin(void);
+void ui_panel(const char *id, vec2 position, vec2 size, vec4 color);
+void ui_label(const char *id, ui32 font, const char *text, vec2 position, vec4 color);
+void ui_bar(const char *id, vec2 position, vec2 size, f32 value, vec4 color, vec4 background);
+void ui_graph(const char *id, vec2 position, vec2 size, const f32 *values, ui32 count, f32 max, vec4 color, vec4 background);
+void ui_stats_graph(const char *id, vec2 position, vec2 size);
\ No newline at end of file
@@ -0,0 +1,296 @@
+#include <string.h>
+
+#include "../util.h"
+#include "../ui.h"
+#include "../render/render_internal.h"
+
+// Widgets are called every frame, immediate mode, but keep the quads they
+// emitted last time. A widget whose id, content and render state hash the
+// same as before appends those quads as they are, so a steady HUD costs a
+// copy per widget and only widgets that changed emit anything. Widgets are
+// emitted without culling, so moving the camera keeps them valid.
+
+#define FNV_OFFSET 0xcbf29ce484222325ull
+#define FNV_PRIME 0x100000001b3ull
+
+typedef struct ui_widget {
+	ui64 id;
+	ui64 hash;
+	Batch_Vertex *vertices;
+	Batch_Quad *quads;
+	usize quad_count;
+	usize quad_capacity;
+	// Text atlas shelves the quads sample, held while they are reused.
+	ui64 text_usage[RENDER_TEXT_USAGE_WORDS];
+	ui32 text_generation;
+	ui32 last_frame;
+	bool is_used;
+} UI_Widget;
+
+typedef struct ui_state {
+	// Open addressing on the id hash, grown at half full.
+	UI_Widget *widgets;
+	ui32 capacity;
+	ui32 count;
+	ui32 frame;
+	usize first;
+} UI_State;
+
+static UI_State ui;
+
+void ui_init(void) {
+	ui.capacity = 64;
+	ui.widgets = calloc(ui.capacity, sizeof(UI_Widget));
+	if(!ui.widgets) {
+		ERROR_EXIT("Could not allocate UI widgets\n");
+	}
+}
+
+// Called once per frame, after render_begin.
+void ui_begin(void) {
+	++ui.frame;
+}
+
+static ui64 hash_bytes(ui64 hash, const void *data, usize size) {
+	const ui8 *bytes = data;
+	for(usize i = 0; i < size; ++i) {
+		hash = (hash ^ bytes[i]) * FNV_PRIME;
+	}
+
+	return hash;
+}
+
+static ui64 hash_string(ui64 hash, const char *string) {
+	return hash_bytes(hash, string, strlen(string) + 1);
+}
+
+static UI_Widget *find_widget(ui64 id) {
+	ui32 mask = ui.capacity - 1;
+	ui32 i = (ui32)id & mask;
+
+	while(ui.widgets[i].is_used && ui.widgets[i].id != id) {
+		i = (i + 1) & mask;
+	}
+
+	return &ui.widgets[i];
+}
+
+static void grow_widgets(void) {
+	UI_Widget *old = ui.widgets;
+	ui32 old_capacity = ui.capacity;
+
+	ui.capacity *= 2;
+	ui.widgets = calloc(ui.capacity, sizeof(UI_Widget));
+	if(!ui.widgets) {
+		ERROR_EXIT("Could not grow UI widgets to %u\n", ui.capacity);
+	}
+
+	for(ui32 i = 0; i < old_capacity; ++i) {
+		if(old[i].is_used) {
+			*find_widget(old[i].id) = old[i];
+		}
+	}
+
+	free(old);
+}
+
+// Appends the widget's kept quads and returns NULL when nothing changed.
+// Otherwise returns the widget for the caller to emit into, followed by
+// widget_end. Kept text stays valid if it was drawn last frame, which
+// keeps its glyphs in the atlas, or if no glyph has moved since.
+static UI_Widget *widget_begin(const char *id, ui64 hash) {
+	Batch_Quad quad;
+	render_batch_state(&quad);
+
+	hash = hash_bytes(hash, &quad.depth, sizeof(quad.depth));
+	hash = hash_bytes(hash, &quad.layer, sizeof(quad.layer));
+	hash = hash_bytes(hash, &quad.blend_mode, sizeof(quad.blend_mode));
+
+	if((ui.count + 1) * 2 > ui.capacity) {
+		grow_widgets();
+	}
+
+	ui64 widget_id = hash_string(FNV_OFFSET, id);
+	UI_Widget *widget = find_widget(widget_id);
+
+	if(!widget->is_used) {
+		*widget = (UI_Widget){.id = widget_id, .is_used = true};
+		++ui.count;
+	} else if(widget->hash == hash && (widget->last_frame + 1 == ui.frame || widget->text_generation == render_text_generation())) {
+		if(widget->quad_count > 0) {
+			render_batch_append(widget->vertices, widget->quads, widget->quad_count);
+		}
+
+		render_text_touch(widget->text_usage);
+		widget->last_frame = ui.frame;
+		return NULL;
+	}
+
+	widget->hash = hash;
+
+	render_text_usage_reset();
+	render_batch_cull(false);
+	ui.first = render_batch_mark();
+
+	return widget;
+}
+
+static void widget_end(UI_Widget *widget) {
+	render_batch_cull(true);
+
+	const Batch_Vertex *vertices;
+	const Batch_Quad *quads;
+	usize count = render_batch_range(ui.first, &vertices, &quads);
+
+	if(count > widget->quad_capacity) {
+		widget->vertices = realloc(widget->vertices, count * 4 * sizeof(Batch_Vertex));
+		widget->quads = realloc(widget->quads, count * sizeof(Batch_Quad));
+		if(!widget->vertices || !widget->quads) {
+			ERROR_EXIT("Could not keep %zu UI quads\n", count);
+		}
+
+		widget->quad_capacity = count;
+	}
+
+	memcpy(widget->vertices, vertices, count * 4 * sizeof(Batch_Vertex));
+	memcpy(widget->quads, quads, count * sizeof(Batch_Quad));
+	widget->quad_count = count;
+
+	render_text_usage(widget->text_usage);
+	widget->text_generation = render_text_generation();
+	widget->last_frame = ui.frame;
+}
+
+static ui64 hash_rect(vec2 position, vec2 size) {
+	ui64 hash = hash_bytes(FNV_OFFSET, position, sizeof(vec2));
+	return hash_bytes(hash, size, sizeof(vec2));
+}
+
+static void draw_rect(vec2 position, vec2 size, vec4 color) {
+	render_quad((vec2){position[0] + size[0] * 0.5f, position[1] + size[1] * 0.5f}, size, color);
+}
+
+// Position is the bottom left corner.
+void ui_panel(const char *id, vec2 position, vec2 size, vec4 color) {
+	ui64 hash = hash_bytes(hash_rect(position, size), color, sizeof(vec4));
+
+	UI_Widget *widget = widget_begin(id, hash);
+	if(!widget) {
+		return;
+	}
+
+	draw_rect(position, size, color);
+	widget_end(widget);
+}
+
+// Position is the start of the baseline, as for render_text.
+void ui_label(const char *id, ui32 font, const char *text, vec2 position, vec4 color) {
+	ui64 hash = hash_bytes(FNV_OFFSET, &font, sizeof(font));
+	hash = hash_string(hash, text);
+	hash = hash_bytes(hash, position, sizeof(vec2));
+	hash = hash_bytes(hash, color, sizeof(vec4));
+
+	UI_Widget *widget = widget_begin(id, hash);
+	if(!widget) {
+		return;
+	}
+
+	render_text(font, text, position, color);
+	widget_end(widget);
+}
+
+// Fills value, from 0 to 1, of the bar from the left.
+void ui_bar(const char *id, vec2 position, vec2 size, f32 value, vec4 color, vec4 background) {
+	value = value < 0 ? 0 : value > 1 ? 1 : value;
+
+	ui64 hash = hash_rect(position, size);
+	hash = hash_bytes(hash, &value, sizeof(value));
+	hash = hash_bytes(hash, color, sizeof(vec4));
+	hash = hash_bytes(hash, background, sizeof(vec4));
+
+	UI_Widget *widget = widget_begin(id, hash);
+	if(!widget) {
+		return;
+	}
+
+	draw_rect(position, size, background);
+	if(value > 0) {
+		draw_rect(position, (vec2){size[0] * value, size[1]}, color);
+	}
+	widget_end(widget);
+}
+
+// One bar per value, oldest on the left, scaled so max fills the height.
+void ui_graph(const char *id, vec2 position, vec2 size, const f32 *values, ui32 count, f32 max, vec4 color, vec4 background) {
+	ui64 hash = hash_rect(position, size);
+	hash = hash_bytes(hash, values, count * sizeof(f32));
+	hash = hash_bytes(hash, &max, sizeof(max));
+	hash = hash_bytes(hash, color, sizeof(vec4));
+	hash = hash_bytes(hash, background, sizeof(vec4));
+
+	UI_Widget *widget = widget_begin(id, hash);
+	if(!widget) {
+		return;
+	}
+
+	draw_rect(position, size, background);
+
+	f32 bar_width = size[0] / count;
+	for(ui32 i = 0; i < count; ++i) {
+		f32 height = values[i] / max * size[1];
+		height = height > size[1] ? size[1] : height;
+
+		if(height > 0) {
+			draw_rect((vec2){position[0] + i * bar_width, position[1]}, (vec2){bar_width, height}, color);
+		}
+	}
+	widget_end(widget);
+}
+
+// GPU time per recorded frame as stacked bars, one colour per pass, with a
+// line at 16.6 ms. The top of the graph is 33.3 ms. Submit it last so it
+// lands on top.
+void ui_stats_graph(const char *id, vec2 position, vec2 size) {
+	static const f32 top_ms = 1000.f / 30.f;
+	vec4 colors[RENDER_PASS_COUNT] = {
+		{0.5, 0, 1, 0.8},
+		{0, 1, 0.5, 0.8},
+		{0, 0.5, 1, 0.8},
+		{1, 0.5, 0, 0.8}
+	};
+
+	Render_Stats history[RENDER_STATS_HISTORY];
+	render_stats_history(history);
+
+	ui64 hash = hash_rect(position, size);
+	for(ui32 i = 0; i < RENDER_STATS_HISTORY; ++i) {
+		hash = hash_bytes(hash, history[i].gpu_ms, sizeof(history[i].gpu_ms));
+	}
+
+	UI_Widget *widget = widget_begin(id, hash);
+	if(!widget) {
+		return;
+	}
+
+	draw_rect(position, size, (vec4){0, 0, 0, 0.6});
+
+	f32 bar_width = size[0] / RENDER_STATS_HISTORY;
+	for(ui32 i = 0; i < RENDER_STATS_HISTORY; ++i) {
+		f32 y = position[1];
+
+		for(ui32 pass = 0; pass < RENDER_PASS_COUNT; ++pass) {
+			f32 height = history[i].gpu_ms[pass] / top_ms * size[1];
+			if(y + height > position[1] + size[1]) {
+				height = position[1] + size[1] - y;
+			}
+
+			if(height > 0) {
+				draw_rect((vec2){position[0] + i * bar_width, y}, (vec2){bar_width, height}, colors[pass]);
+				y += height;
+			}
+		}
+	}
+
+	draw_rect((vec2){position[0], position[1] + size[1] * 0.5f - 0.5f}, (vec2){size[0], 1}, (vec4){1, 1, 1, 0.5});
+	widget_end(widget);
+}
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
 #include <glad/glad.h>
 
 #define SDL_MAIN_HANDLED
@@ -17,6 +19,9 @@
 #include "engine/render.h"
 #include "engine/animation.h"
 #include "engine/audio.h"
+#include "engine/job.h"
+#include "engine/io.h"
+#include "engine/ui.h"
 
 static Mix_Music *MUSIC_STAGE_1;
 static Mix_Chunk *SOUND_JUMP;
@@ -37,6 +42,7 @@ static f32 render_width;
 static f32 render_height;
 
 static bool should_quit = false;
+static bool show_render_stats = false;
 static vec4 player_color = {0, 1, 1, 1};
 static bool player_is_grounded = false;
 static usize anim_player_walk_id;
@@ -152,11 +158,13 @@ void spawn_enemy(bool is_small, bool is_enraged, bool is_flipped) {
 int main(int argc, char *argv[]) {
 	time_init(60);
 	config_init();
+	job_init();
 	SDL_Window *window = render_init();
 	physics_init();
 	entity_init();
 	animation_init();
 	audio_init();
+	ui_init();
 
 	audio_sound_load(&SOUND_JUMP, "assets/jump.wav");
 	audio_music_load(&MUSIC_STAGE_1, "assets/map.wav");
@@ -192,11 +200,15 @@ int main(int argc, char *argv[]) {
 	Sprite_Sheet sprite_sheet_enemy_large;
 	Sprite_Sheet sprite_sheet_props;
 
-	render_sprite_sheet_init(&sprite_sheet_player, "assets/player.png", 24, 24);
-	render_sprite_sheet_init(&sprite_sheet_map, "assets/map.png", 640, 360);
-	render_sprite_sheet_init(&sprite_sheet_enemy_small, "assets/enemy_small.png", 24, 24);
-	render_sprite_sheet_init(&sprite_sheet_enemy_large, "assets/enemy_large.png", 40, 40);
-	render_sprite_sheet_init(&sprite_sheet_props, "assets/props_16x16.png", 16, 16);
+	render_sprite_sheet_load(&sprite_sheet_player, "assets/player.png", 24, 24);
+	render_sprite_sheet_load(&sprite_sheet_map, "assets/map.png", 640, 360);
+	render_sprite_sheet_load(&sprite_sheet_enemy_small, "assets/enemy_small.png", 24, 24);
+	render_sprite_sheet_load(&sprite_sheet_enemy_large, "assets/enemy_large.png", 40, 40);
+	render_sprite_sheet_load(&sprite_sheet_props, "assets/props_16x16.png", 16, 16);
+
+	// Text is drawn only when a font is present.
+	bool has_font = io_file_exists("assets/font.ttf");
+	ui32 font = has_font ? render_font_load("assets/font.ttf", 8) : 0;
 
 	usize adef_player_walk_id = animation_definition_create(&sprite_sheet_player, 0.1, 0, (ui8[]){1, 2, 3, 4, 5, 6, 7}, 7);
 	usize adef_player_idle_id = animation_definition_create(&sprite_sheet_player, 0, 0, (ui8[]){0}, 1);
@@ -208,11 +220,38 @@ int main(int argc, char *argv[]) {
 	anim_enemy_small_id = animation_create(adef_enemy_small_id, true);
 	anim_enemy_large_id = animation_create(adef_enemy_large_id, true);
 
+	render_thread_start(window);
+
+	for(i32 i = 1; i < argc; ++i) {
+		if(strcmp(argv[i], "--stats") == 0) {
+			show_render_stats = true;
+		} else if(strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+			const char *path = argv[++i];
+			ui32 frame_count = 60;
+			if(i + 1 < argc && isdigit((unsigned char)argv[i + 1][0])) {
+				frame_count = (ui32)atoi(argv[++i]);
+			}
+			render_capture_begin(path, frame_count);
+		} else if(strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+			const char *extension = strrchr(argv[i + 1], '.');
+			Render_Video_Format format = RENDER_VIDEO_PNG;
+			if(extension && strcmp(extension, ".y4m") == 0) {
+				format = RENDER_VIDEO_Y4M;
+			} else if(extension && strcmp(extension, ".raw") == 0) {
+				format = RENDER_VIDEO_RAW;
+			}
+			render_video_begin(argv[i + 1], format, global.time.frame_rate);
+			++i;
+		} else if(strcmp(argv[i], "--dynamic-resolution") == 0 && i + 1 < argc) {
+			render_set_dynamic_resolution(true, (f32)atof(argv[i + 1]));
+			++i;
+		}
+	}
+
 	Entity *player = entity_get(player_id);
 	player->animation_id = anim_player_idle_id;
 
 	f32 spawn_timer = 0;
-	ui32 texture_slots[8] = {0};
 
 	while(!should_quit) {
 		time_update();
@@ -265,8 +304,16 @@ int main(int argc, char *argv[]) {
 
 
 		render_begin();
+		ui_begin();
 
-		render_sprite_sheet_frame(&sprite_sheet_map, 0, 0, (vec2){render_width * 0.5, render_height * 0.5}, false, (vec4){1, 1, 1, 0.2}, texture_slots);
+		if(render_static_begin()) {
+			render_sprite_sheet_frame(&sprite_sheet_map, 0, 0, (vec2){render_width * 0.5, render_height * 0.5}, false, (vec4){1, 1, 1, 0.2});
+
+			for(usize i = 0; i < physics_static_body_count(); ++i) {
+				render_aabb((f32*)physics_static_body_get(i), WHITE);
+			}
+		}
+		render_static_end();
 
 		for(usize i = 0; i < entity_count(); ++i) {
 			Entity* entity = entity_get(i);
@@ -278,10 +325,6 @@ int main(int argc, char *argv[]) {
 				render_aabb((f32*)body, RED);
 		}
 
-		for(usize i = 0; i < physics_static_body_count(); ++i) {
-			render_aabb((f32*)physics_static_body_get(i), WHITE);
-		}
-
 		for(usize i = 0; i < entity_count(); ++i) {
 			Entity *entity = entity_get(i);
 
@@ -300,13 +343,28 @@ int main(int argc, char *argv[]) {
 
 			vec2 pos;
 			vec2_add(pos, body->aabb.position, entity->sprite_offset);
-			animation_render(anim, pos, WHITE, texture_slots);
+			animation_render(anim, pos, WHITE);
 		}
 
-		render_sprite_sheet_frame(&sprite_sheet_player, 1, 2, (vec2){100, 100}, false, WHITE, texture_slots);
-		render_sprite_sheet_frame(&sprite_sheet_player, 0, 4, (vec2){100, 100}, false, WHITE, texture_slots);
+		render_sprite_sheet_frame(&sprite_sheet_player, 1, 2, (vec2){100, 100}, false, WHITE);
+		render_sprite_sheet_frame(&sprite_sheet_player, 0, 4, (vec2){100, 100}, false, WHITE);
+
+		ui_panel("hud", (vec2){4, render_height - 28}, (vec2){104, 24}, (vec4){0, 0, 0, 0.6});
+		ui_bar("hud_spawn", (vec2){8, render_height - 24}, (vec2){96, 4}, spawn_timer / 0.8f, RED, (vec4){1, 1, 1, 0.2});
+		if(has_font) {
+			char hud[64];
+			snprintf(hud, sizeof(hud), "entities %zu", entity_count());
+			ui_label("hud_entities", font, hud, (vec2){8, render_height - 14}, WHITE);
+		}
 
-		render_end(window, texture_slots);
+		if(show_render_stats) {
+			ui_stats_graph("render_stats", (vec2){8, 8}, (vec2){120, 40});
+			if(has_font) {
+				render_stats_text(font, (vec2){8, 56 + 3 * render_font_line_height(font)});
+			}
+		}
+
+		render_end(window);
 		
 		player_color[0] = 0;
 		player_color[2] = 1;
@@ -314,5 +372,10 @@ int main(int argc, char *argv[]) {
 		time_update_late();
 	}
 
+	render_thread_stop();
+	render_video_end();
+	render_shutdown();
+	job_shutdown();
+
 	return 0;
 }
\ No newline at end of file
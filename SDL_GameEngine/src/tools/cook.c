@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "../engine/types.h"
+#include "../engine/util.h"
+#include "../engine/io.h"
+#include "../engine/render/render_ctex.h"
+
+// Cooks images into .ctex files next to them, which the engine maps and
+// uploads in place of decoding the image. --premultiply stores colour
+// premultiplied by alpha. --palette stores 8-bit indices into a palette
+// when the image has at most 256 colours.
+//
+// usage: cook [--premultiply] [--palette] <image.png>...
+
+static void premultiply(ui8 *pixels, usize pixel_count) {
+	for(usize i = 0; i < pixel_count; ++i) {
+		ui8 *pixel = &pixels[i * 4];
+		for(ui32 c = 0; c < 3; ++c) {
+			pixel[c] = (ui8)((pixel[c] * pixel[3] + 127) / 255);
+		}
+	}
+}
+
+// Returns the palette size, or 0 when there are more than 256 colours.
+static ui32 palettize(const ui32 *pixels, usize pixel_count, ui32 palette[256], ui8 *indices) {
+	ui32 palette_count = 0;
+
+	for(usize i = 0; i < pixel_count; ++i) {
+		ui32 index = 0;
+		while(index < palette_count && palette[index] != pixels[i]) {
+			++index;
+		}
+
+		if(index == palette_count) {
+			if(palette_count == 256) {
+				return 0;
+			}
+
+			palette[palette_count++] = pixels[i];
+		}
+
+		indices[i] = (ui8)index;
+	}
+
+	return palette_count;
+}
+
+static void cook(const char *path, bool is_premultiplied, bool is_palettized) {
+	int width, height, channel_count;
+	ui8 *pixels = stbi_load(path, &width, &height, &channel_count, 4);
+	if(!pixels) {
+		ERROR_EXIT("Failed to load image: %s\n", path);
+	}
+
+	usize pixel_count = (usize)width * height;
+	if(is_premultiplied) {
+		premultiply(pixels, pixel_count);
+	}
+
+	Render_Ctex_Header *header = malloc(sizeof(Render_Ctex_Header) + 256 * 4 + pixel_count * 4);
+	if(!header) {
+		ERROR_EXIT("Could not allocate %dx%d texture\n", width, height);
+	}
+
+	*header = (Render_Ctex_Header){
+		.magic = RENDER_CTEX_MAGIC,
+		.version = RENDER_CTEX_VERSION,
+		.width = (ui32)width,
+		.height = (ui32)height,
+		.flags = is_premultiplied ? RENDER_CTEX_PREMULTIPLIED : 0
+	};
+
+	if(!io_file_stat(path, &header->source_size, &header->source_mtime)) {
+		ERROR_EXIT("Cannot stat image: %s\n", path);
+	}
+
+	ui8 *data = (ui8*)(header + 1);
+	usize size = sizeof(*header) + pixel_count * 4;
+
+	if(is_palettized) {
+		ui32 palette[256];
+		ui8 *indices = malloc(pixel_count);
+		ui32 palette_count = indices ? palettize((const ui32*)pixels, pixel_count, palette, indices) : 0;
+
+		if(palette_count > 0) {
+			header->flags |= RENDER_CTEX_PALETTIZED;
+			header->palette_count = palette_count;
+			memcpy(data, palette, palette_count * 4);
+			memcpy(data + palette_count * 4, indices, pixel_count);
+			size = sizeof(*header) + palette_count * 4 + pixel_count;
+		} else {
+			printf("%s: more than 256 colours, storing raw pixels\n", path);
+		}
+
+		free(indices);
+	}
+
+	if(!(header->flags & RENDER_CTEX_PALETTIZED)) {
+		memcpy(data, pixels, pixel_count * 4);
+	}
+
+	char out_path[256];
+	const char *extension = strrchr(path, '.');
+	usize stem = extension ? (usize)(extension - path) : strlen(path);
+	snprintf(out_path, sizeof(out_path), "%.*s.ctex", (int)stem, path);
+
+	if(io_file_write(header, size, out_path) != 0) {
+		exit(1);
+	}
+
+	printf("%s: %dx%d, %zu bytes\n", out_path, width, height, size);
+
+	free(header);
+	stbi_image_free(pixels);
+}
+
+int main(int argc, char *argv[]) {
+	bool is_premultiplied = false;
+	bool is_palettized = false;
+	i32 first = 1;
+
+	for(; first < argc && argv[first][0] == '-'; ++first) {
+		if(strcmp(argv[first], "--premultiply") == 0) {
+			is_premultiplied = true;
+		} else if(strcmp(argv[first], "--palette") == 0) {
+			is_palettized = true;
+		} else {
+			ERROR_EXIT("Unknown option: %s\n", argv[first]);
+		}
+	}
+
+	if(first == argc) {
+		ERROR_EXIT("usage: %s [--premultiply] [--palette] <image.png>...\n", argv[0]);
+	}
+
+	// Same row order as the engine's loader, so pixels upload as they are.
+	stbi_set_flip_vertically_on_load(1);
+
+	for(i32 i = first; i < argc; ++i) {
+		cook(argv[i], is_premultiplied, is_palettized);
+	}
+
+	return 0;
+}
\ No newline at end of file
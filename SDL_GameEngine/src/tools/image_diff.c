@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "../engine/types.h"
+#include "../engine/util.h"
+#include "../engine/io.h"
+
+// Compares two images pixel by pixel. Exits with 0 when every channel is
+// within the tolerance, 1 otherwise. --out writes a diff image: matching
+// pixels are dimmed, differing ones are red.
+//
+// usage: image_diff <expected.png> <actual.png> [--tolerance N] [--out diff.png]
+
+int main(int argc, char *argv[]) {
+	if(argc < 3) {
+		ERROR_EXIT("usage: %s <expected.png> <actual.png> [--tolerance N] [--out diff.png]\n", argv[0]);
+	}
+
+	i32 tolerance = 0;
+	const char *out_path = NULL;
+
+	for(i32 i = 3; i < argc; i += 2) {
+		if(i + 1 == argc) {
+			ERROR_EXIT("Option %s needs a value\n", argv[i]);
+		}
+
+		if(strcmp(argv[i], "--tolerance") == 0) {
+			tolerance = atoi(argv[i + 1]);
+		} else if(strcmp(argv[i], "--out") == 0) {
+			out_path = argv[i + 1];
+		} else {
+			ERROR_EXIT("Unknown option: %s\n", argv[i]);
+		}
+	}
+
+	int expected_width, expected_height, actual_width, actual_height, channel_count;
+	ui8 *expected = stbi_load(argv[1], &expected_width, &expected_height, &channel_count, 4);
+	ui8 *actual = stbi_load(argv[2], &actual_width, &actual_height, &channel_count, 4);
+	if(!expected || !actual) {
+		ERROR_EXIT("Failed to load image: %s\n", expected ? argv[2] : argv[1]);
+	}
+
+	if(expected_width != actual_width || expected_height != actual_height) {
+		printf("size differs: %dx%d vs %dx%d\n", expected_width, expected_height, actual_width, actual_height);
+		return 1;
+	}
+
+	usize pixel_count = (usize)expected_width * expected_height;
+	usize different = 0;
+	i32 max_delta = 0;
+	ui8 *diff = out_path ? malloc(pixel_count * 4) : NULL;
+
+	for(usize i = 0; i < pixel_count; ++i) {
+		i32 delta = 0;
+
+		for(ui32 c = 0; c < 4; ++c) {
+			i32 d = abs((i32)expected[i * 4 + c] - (i32)actual[i * 4 + c]);
+			delta = d > delta ? d : delta;
+		}
+
+		max_delta = delta > max_delta ? delta : max_delta;
+		if(delta > tolerance) {
+			++different;
+		}
+
+		if(diff) {
+			bool is_different = delta > tolerance;
+			diff[i * 4 + 0] = is_different ? 255 : expected[i * 4 + 0] / 4;
+			diff[i * 4 + 1] = is_different ? 0 : expected[i * 4 + 1] / 4;
+			diff[i * 4 + 2] = is_different ? 0 : expected[i * 4 + 2] / 4;
+			diff[i * 4 + 3] = 255;
+		}
+	}
+
+	if(diff) {
+		io_png_write(out_path, diff, expected_width, expected_height);
+		free(diff);
+	}
+
+	printf("%zu of %zu pixels differ, max channel delta %d\n", different, pixel_count, max_delta);
+
+	stbi_image_free(expected);
+	stbi_image_free(actual);
+
+	return different > 0 ? 1 : 0;
+}
\ No newline at end of file
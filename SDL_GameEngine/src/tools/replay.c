@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <glad/glad.h>
+
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+#include "../engine/render.h"
+#include "../engine/io.h"
+#include "../engine/util.h"
+#include "../engine/array_list.h"
+#include "../engine/render/render_internal.h"
+
+// Replays a render capture against the headless renderer, timing the GL
+// side of every captured frame. --png saves the last frame for comparing
+// against a golden image with image_diff.
+//
+// usage: replay <capture file> [--loops N] [--png path]
+
+typedef struct replay_texture {
+	ui32 captured_id;
+	ui32 texture_id;
+} Replay_Texture;
+
+typedef struct replay_stats {
+	f64 total;
+	f64 min;
+	f64 max;
+	usize frame_count;
+	usize quad_count;
+	usize draw_calls;
+} Replay_Stats;
+
+static Array_List *replay_textures;
+
+static ui32 *find_texture(ui32 captured_id) {
+	Replay_Texture *textures = replay_textures->items;
+	for(usize i = 0; i < replay_textures->len; ++i) {
+		if(textures[i].captured_id == captured_id) {
+			return &textures[i].texture_id;
+		}
+	}
+
+	return NULL;
+}
+
+static ui32 remap_texture(ui32 captured_id) {
+	if(captured_id == 0) {
+		return 0;
+	}
+
+	ui32 *texture_id = find_texture(captured_id);
+	if(!texture_id) {
+		ERROR_EXIT("Capture references texture %u before defining it\n", captured_id);
+	}
+
+	return *texture_id;
+}
+
+static void load_texture(const Render_Capture_Texture *texture) {
+	ui32 *texture_id = find_texture(texture->texture_id);
+	if(!texture_id) {
+		Replay_Texture replay = {.captured_id = texture->texture_id};
+		glGenTextures(1, &replay.texture_id);
+		texture_id = &((Replay_Texture*)replay_textures->items)[array_list_append(replay_textures, &replay)].texture_id;
+	}
+
+	render_state_bind_texture(0, *texture_id);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, texture->width, texture->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, texture + 1);
+}
+
+static void replay_frame(Render_Frame *frame, const Render_Capture_Frame *captured, Replay_Stats *stats) {
+	const Batch_Vertex *vertices = (const Batch_Vertex*)(captured + 1);
+	const Batch_Quad *quads = (const Batch_Quad*)(vertices + captured->quad_count * 4);
+	const Mesh_Draw *meshes = (const Mesh_Draw*)(quads + captured->quad_count);
+
+	frame->vertices->len = 0;
+	frame->quads->len = 0;
+	frame->meshes->len = 0;
+	frame->commands->len = 0;
+
+	Batch_Vertex *frame_vertices = array_list_append_n(frame->vertices, captured->quad_count * 4);
+	Batch_Quad *frame_quads = array_list_append_n(frame->quads, captured->quad_count);
+	Mesh_Draw *frame_meshes = array_list_append_n(frame->meshes, captured->mesh_count);
+	if(!frame_vertices || !frame_quads || !frame_meshes) {
+		ERROR_EXIT("Could not allocate replay frame\n");
+	}
+
+	memcpy(frame_vertices, vertices, captured->quad_count * 4 * sizeof(Batch_Vertex));
+	memcpy(frame_quads, quads, captured->quad_count * sizeof(Batch_Quad));
+	memcpy(frame_meshes, meshes, captured->mesh_count * sizeof(Mesh_Draw));
+
+	for(ui32 i = 0; i < captured->quad_count; ++i) {
+		frame_quads[i].texture_id = remap_texture(frame_quads[i].texture_id);
+	}
+
+	for(ui32 i = 0; i < captured->mesh_count; ++i) {
+		frame_meshes[i].texture_id = remap_texture(frame_meshes[i].texture_id);
+	}
+
+	mat4x4_dup(frame->projection, captured->projection);
+	frame->is_sorted = captured->is_sorted;
+	frame->capture = RENDER_CAPTURE_NONE;
+
+	ui64 start = SDL_GetPerformanceCounter();
+	render_frame_draw(frame);
+	glFinish();
+	f64 ms = (f64)(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+
+	stats->total += ms;
+	stats->min = ms < stats->min ? ms : stats->min;
+	stats->max = ms > stats->max ? ms : stats->max;
+	stats->quad_count += captured->quad_count;
+	stats->draw_calls += frame->stats.draw_calls;
+	++stats->frame_count;
+}
+
+static void replay_pass(const ui8 *data, usize len, Render_Frame *frame, Replay_Stats *stats, const char *png_path) {
+	usize offset = sizeof(Render_Capture_Header);
+
+	while(offset + sizeof(Render_Capture_Chunk) <= len) {
+		const Render_Capture_Chunk *chunk = (const Render_Capture_Chunk*)(data + offset);
+		const void *body = chunk + 1;
+		offset += sizeof(Render_Capture_Chunk) + chunk->size;
+
+		if(offset > len) {
+			ERROR_EXIT("Capture is truncated\n");
+		}
+
+		switch(chunk->type) {
+			case RENDER_CAPTURE_CHUNK_TEXTURE: {
+				load_texture(body);
+			} break;
+			case RENDER_CAPTURE_CHUNK_MESH: {
+				const Render_Capture_Mesh *mesh = body;
+				render_mesh_buffers_upload(mesh->id, (const Batch_Vertex*)(mesh + 1), mesh->quad_count);
+			} break;
+			case RENDER_CAPTURE_CHUNK_PALETTES: {
+				render_palette_upload(body);
+			} break;
+			case RENDER_CAPTURE_CHUNK_FRAME: {
+				if(png_path && offset == len) {
+					snprintf(frame->screenshot_path, sizeof(frame->screenshot_path), "%s", png_path);
+				}
+
+				replay_frame(frame, body, stats);
+			} break;
+			default:
+				ERROR_EXIT("Unknown capture chunk type %u\n", chunk->type);
+		}
+	}
+}
+
+int main(int argc, char *argv[]) {
+	if(argc < 2) {
+		ERROR_EXIT("usage: %s <capture file> [--loops N] [--png path]\n", argv[0]);
+	}
+
+	ui32 loop_count = 100;
+	const char *png_path = NULL;
+
+	for(i32 i = 2; i + 1 < argc; i += 2) {
+		if(strcmp(argv[i], "--loops") == 0) {
+			loop_count = (ui32)atoi(argv[i + 1]);
+		} else if(strcmp(argv[i], "--png") == 0) {
+			png_path = argv[i + 1];
+		} else {
+			ERROR_EXIT("Unknown option: %s\n", argv[i]);
+		}
+	}
+
+	File file = io_file_read(argv[1]);
+	if(!file.is_valid) {
+		ERROR_EXIT("Could not read capture: %s\n", argv[1]);
+	}
+
+	const Render_Capture_Header *header = (const Render_Capture_Header*)file.data;
+	if(file.len < sizeof(*header) || header->magic != RENDER_CAPTURE_MAGIC || header->version != RENDER_CAPTURE_VERSION) {
+		ERROR_EXIT("Not a render capture: %s\n", argv[1]);
+	}
+
+	if(header->vertex_size != sizeof(Batch_Vertex) || header->quad_size != sizeof(Batch_Quad)) {
+		ERROR_EXIT("Capture was written by an incompatible renderer\n");
+	}
+
+	SDL_Window *window = render_init_headless();
+
+	replay_textures = array_list_create(sizeof(Replay_Texture), 0);
+
+	Render_Frame frame = {
+		.vertices = array_list_create(sizeof(Batch_Vertex), MAX_BATCH_VERTICES),
+		.quads = array_list_create(sizeof(Batch_Quad), MAX_BATCH_QUADS),
+		.meshes = array_list_create(sizeof(Mesh_Draw), 0),
+		.commands = array_list_create(1, 0)
+	};
+
+	Replay_Stats stats = {.min = DBL_MAX};
+
+	for(ui32 i = 0; i < loop_count; ++i) {
+		replay_pass((const ui8*)file.data, file.len, &frame, &stats, i + 1 == loop_count ? png_path : NULL);
+		SDL_GL_SwapWindow(window);
+	}
+
+	if(stats.frame_count == 0) {
+		ERROR_EXIT("Capture holds no frames\n");
+	}
+
+	printf("%zu frames, %zu quads/frame, %zu draw calls/frame\n", stats.frame_count, stats.quad_count / stats.frame_count, stats.draw_calls / stats.frame_count);
+	printf("avg %.3f ms, min %.3f ms, max %.3f ms\n", stats.total / stats.frame_count, stats.min, stats.max);
+
+	free(file.data);
+
+	return 0;
+}
\ No newline at end of file